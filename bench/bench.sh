@@ -0,0 +1,5 @@
+mkdir -p bin
+g++ -I./include -Wall -Wextra -std=c++17 -O2 bench/fetch_reuse.cpp src/fetch_engine.cpp src/curl_share.cpp src/link_scanner.cpp src/page_extractors.cpp src/dom_visitor.cpp src/parse_arena.cpp src/url_normalizer.cpp -o bin/bench_fetch_reuse -lcurl -lgumbo -pthread
+g++ -I./include -Wall -Wextra -std=c++17 -O2 bench/frontier_contention.cpp src/url_frontier.cpp src/spill_queue.cpp src/url_view.cpp src/fingerprint.cpp -o bin/bench_frontier_contention -pthread
+g++ -I./include -Wall -Wextra -std=c++17 -O2 bench/url_normalize.cpp src/url_normalizer.cpp -o bin/bench_url_normalize
+g++ -I./include -Wall -Wextra -std=c++17 -O2 bench/extract_compare.cpp src/link_scanner.cpp src/page_extractors.cpp src/dom_visitor.cpp src/parse_arena.cpp src/url_normalizer.cpp -o bin/bench_extract_compare -lgumbo -pthread
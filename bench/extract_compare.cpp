@@ -0,0 +1,133 @@
+// Runs the link scanner and the Gumbo extractors over every .html/.htm file
+// under a directory and reports, per field, how many pages disagree, plus
+// the first few differences in detail. This is what --extract=compare
+// checks during a crawl, on a fixed corpus instead of live pages.
+//
+// Each file is treated as if fetched from http://corpus.test/<relative path>.
+//
+// usage: bench_extract_compare <corpus-dir> [max-pages=0 (all)] [details=10]
+#include "link_scanner.h"
+#include "page_extractors.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static std::string clip(const std::string &text)
+{
+    return text.size() > 120 ? text.substr(0, 120) + "..." : text;
+}
+
+static std::string firstDifference(const std::vector<std::string> &dom, const std::vector<std::string> &scanned)
+{
+    size_t i = 0;
+    while (i < dom.size() && i < scanned.size() && dom[i] == scanned[i])
+        ++i;
+    // Long links usually differ near the end, so the tail is shown
+    auto tail = [](const std::string &link) {
+        return link.size() > 120 ? "..." + link.substr(link.size() - 117) : link;
+    };
+    std::string domLink = i < dom.size() ? tail(dom[i]) : "(end)";
+    std::string scanLink = i < scanned.size() ? tail(scanned[i]) : "(end)";
+    return std::to_string(dom.size()) + " vs " + std::to_string(scanned.size()) + " links, first at #" +
+           std::to_string(i) + ": gumbo " + domLink + " / scanner " + scanLink;
+}
+
+int main(int argc, char *argv[])
+{
+    if (argc < 2)
+    {
+        std::cerr << "usage: " << argv[0] << " <corpus-dir> [max-pages] [details]" << std::endl;
+        return 1;
+    }
+    fs::path root(argv[1]);
+    size_t maxPages = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 0;
+    size_t details = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 10;
+
+    std::vector<fs::path> files;
+    for (const auto &entry : fs::recursive_directory_iterator(root))
+    {
+        std::string extension = entry.path().extension().string();
+        if (entry.is_regular_file() && (extension == ".html" || extension == ".htm"))
+            files.push_back(entry.path());
+    }
+    std::sort(files.begin(), files.end());
+    if (maxPages > 0 && files.size() > maxPages)
+        files.resize(maxPages);
+
+    const char *fields[] = {"title", "description", "links", "canonical", "robots", "nofollow links"};
+    size_t differing[6] = {};
+    size_t mismatched = 0;
+    size_t bytes = 0;
+    size_t links = 0;
+    double domSeconds = 0;
+    double scanSeconds = 0;
+    for (const auto &file : files)
+    {
+        std::ifstream in(file, std::ios::binary);
+        std::stringstream buffer;
+        buffer << in.rdbuf();
+        std::string html = buffer.str();
+        bytes += html.size();
+
+        PageMetadata dom;
+        PageMetadata scanned;
+        dom.url = scanned.url = "http://corpus.test/" + fs::relative(file, root).generic_string();
+        dom.depth = scanned.depth = 0;
+        auto start = std::chrono::steady_clock::now();
+        extractPage(html, dom);
+        auto parsed = std::chrono::steady_clock::now();
+        scanPage(html, scanned);
+        auto done = std::chrono::steady_clock::now();
+        domSeconds += std::chrono::duration<double>(parsed - start).count();
+        scanSeconds += std::chrono::duration<double>(done - parsed).count();
+        links += dom.links.size();
+
+        bool same[6] = {
+            scanned.title == dom.title,
+            scanned.description == dom.description,
+            scanned.links == dom.links,
+            scanned.canonical == dom.canonical,
+            scanned.noindex == dom.noindex && scanned.nofollow == dom.nofollow,
+            scanned.nofollowLinks == dom.nofollowLinks,
+        };
+        std::string differences;
+        for (size_t f = 0; f < 6; ++f)
+        {
+            if (same[f])
+                continue;
+            differing[f]++;
+            differences += differences.empty() ? fields[f] : std::string(", ") + fields[f];
+        }
+        if (differences.empty())
+            continue;
+        if (mismatched++ < details)
+        {
+            std::cout << "differs: " << dom.url << ": " << differences << std::endl;
+            if (!same[0])
+                std::cout << "  title: gumbo \"" << clip(dom.title) << "\" / scanner \"" << clip(scanned.title) << "\""
+                          << std::endl;
+            if (!same[1])
+                std::cout << "  description: gumbo \"" << clip(dom.description) << "\" / scanner \""
+                          << clip(scanned.description) << "\"" << std::endl;
+            if (!same[2])
+                std::cout << "  " << firstDifference(dom.links, scanned.links) << std::endl;
+        }
+    }
+
+    std::cout << files.size() << " pages, " << bytes / 1e6 << " MB, " << links << " links from Gumbo" << std::endl;
+    std::cout << mismatched << " pages differ";
+    for (size_t f = 0; f < 6; ++f)
+        std::cout << (f == 0 ? " (" : ", ") << fields[f] << " " << differing[f];
+    std::cout << ")" << std::endl;
+    std::cout << "gumbo:   " << bytes / domSeconds / 1e6 << " MB/s" << std::endl;
+    std::cout << "scanner: " << bytes / scanSeconds / 1e6 << " MB/s" << std::endl;
+    return mismatched == 0 ? 0 : 2;
+}
@@ -0,0 +1,169 @@
+// Requests/s against a loopback HTTP/1.1 server, with and without
+// connection and handle reuse.
+//
+//   fresh:  a new easy handle per URL and CURLOPT_FORBID_REUSE, so every
+//           request pays for curl_easy_init and a TCP connect
+//   engine: FetchEngine as the crawler uses it, with pooled handles and
+//           keep-alive connections
+//
+// usage: bench_fetch_reuse [requests=20000] [inFlight=8]
+#include "fetch_engine.h"
+#include <iostream>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <atomic>
+#include <cstring>
+#include <cstdlib>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+static const std::string kBody = "<html><head><title>bench</title></head><body>ok</body></html>";
+
+static void serveConnection(int fd)
+{
+    std::string response = "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\nContent-Length: " +
+                           std::to_string(kBody.size()) + "\r\n\r\n" + kBody;
+    std::string buffer;
+    char chunk[4096];
+    while (true)
+    {
+        ssize_t n = read(fd, chunk, sizeof(chunk));
+        if (n <= 0)
+            break;
+        buffer.append(chunk, n);
+        size_t end;
+        while ((end = buffer.find("\r\n\r\n")) != std::string::npos)
+        {
+            buffer.erase(0, end + 4);
+            if (write(fd, response.data(), response.size()) < 0)
+                break;
+        }
+    }
+    close(fd);
+}
+
+static int startServer(std::atomic<bool> &stopping)
+{
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    int one = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    sockaddr_in addr{};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0 || listen(listener, 1024) != 0)
+    {
+        std::cerr << "Cannot listen on loopback" << std::endl;
+        std::exit(1);
+    }
+    socklen_t length = sizeof(addr);
+    getsockname(listener, reinterpret_cast<sockaddr *>(&addr), &length);
+
+    std::thread([listener, &stopping]() {
+        while (!stopping)
+        {
+            int fd = accept(listener, nullptr, nullptr);
+            if (fd >= 0)
+                std::thread(serveConnection, fd).detach();
+        }
+    }).detach();
+    return ntohs(addr.sin_port);
+}
+
+static size_t discard(char *, size_t size, size_t nmemb, void *)
+{
+    return size * nmemb;
+}
+
+static double runFresh(const std::string &url, size_t requests, size_t inFlight, long &connects)
+{
+    CURLM *multi = curl_multi_init();
+    size_t started = 0;
+    size_t done = 0;
+    auto addOne = [&]() {
+        CURL *curl = curl_easy_init();
+        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, discard);
+        curl_easy_setopt(curl, CURLOPT_FORBID_REUSE, 1L);
+        curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+        curl_multi_add_handle(multi, curl);
+        started++;
+    };
+
+    auto start = std::chrono::steady_clock::now();
+    while (started < std::min(requests, inFlight))
+        addOne();
+    while (done < requests)
+    {
+        int running = 0;
+        curl_multi_perform(multi, &running);
+        int remaining = 0;
+        while (CURLMsg *msg = curl_multi_info_read(multi, &remaining))
+        {
+            if (msg->msg != CURLMSG_DONE)
+                continue;
+            long opened = 0;
+            curl_easy_getinfo(msg->easy_handle, CURLINFO_NUM_CONNECTS, &opened);
+            connects += opened;
+            curl_multi_remove_handle(multi, msg->easy_handle);
+            curl_easy_cleanup(msg->easy_handle);
+            done++;
+            if (started < requests)
+                addOne();
+        }
+        if (done < requests)
+            curl_multi_poll(multi, nullptr, 0, 100, nullptr);
+    }
+    curl_multi_cleanup(multi);
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double runEngine(const std::string &url, size_t requests, size_t inFlight, FetchStats &stats)
+{
+    MpmcRing<FetchResult> completed(4096);
+    FetchEngine engine(completed, nullptr, inFlight);
+    auto start = std::chrono::steady_clock::now();
+    engine.start();
+    for (size_t i = 0; i < requests; ++i)
+    {
+        engine.submit(FetchRequest{url, 0});
+    }
+    size_t done = 0;
+    FetchResult result;
+    while (done < requests)
+    {
+        if (completed.wait_pop(result, std::chrono::milliseconds(100)))
+            done++;
+    }
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    engine.stop();
+    stats = engine.stats();
+    return seconds;
+}
+
+int main(int argc, char *argv[])
+{
+    size_t requests = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 20000;
+    size_t inFlight = argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 8;
+
+    std::atomic<bool> stopping{false};
+    int port = startServer(stopping);
+    std::string url = "http://127.0.0.1:" + std::to_string(port) + "/";
+    curl_global_init(CURL_GLOBAL_ALL);
+
+    long freshConnects = 0;
+    double fresh = runFresh(url, requests, inFlight, freshConnects);
+    FetchStats stats;
+    double pooled = runEngine(url, requests, inFlight, stats);
+
+    std::cout << requests << " GETs, " << inFlight << " in flight" << std::endl;
+    std::cout << "fresh handle, no reuse: " << requests / fresh << " req/s, " << freshConnects << " connects"
+              << std::endl;
+    std::cout << "FetchEngine, pooled:    " << requests / pooled << " req/s, " << stats.connectionsOpened
+              << " connects, " << stats.handlesCreated << " handles" << std::endl;
+
+    stopping = true;
+    curl_global_cleanup();
+    return 0;
+}
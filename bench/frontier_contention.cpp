@@ -0,0 +1,140 @@
+// Links/s through the worker hand-off at 8, 32 and 128 threads.
+//
+//   mutex queue:  the original path, one ThreadSafeQueue that every link is
+//                 pushed to and popped from on its own
+//   crawler path: per-worker work-stealing deques of page batches, moved
+//                 into UrlFrontier with push_batch and served by try_pop
+//
+// Every thread produces pages of 25 links spread over 1000 hosts and
+// consumes until all links are drained. The frontier runs with no
+// politeness delay so only the hand-off is measured.
+//
+// usage: bench_frontier_contention [pages=40000]
+#include "thread_safe_queue.h"
+#include "url_frontier.h"
+#include "work_stealing_deque.h"
+#include <atomic>
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Item = std::pair<std::string, int>;
+using Batch = std::vector<Item>;
+
+static const int kLinks = 25;
+static const int kHosts = 1000;
+
+static std::string makeUrl(long n)
+{
+    return "http://h" + std::to_string(n % kHosts) + ".test/p" + std::to_string(n);
+}
+
+static double runMutexQueue(int threads, long pagesPer)
+{
+    ThreadSafeQueue<Item> queue;
+    std::atomic<long> consumed{0};
+    long total = pagesPer * threads * kLinks;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]() {
+            Item item;
+            long next = static_cast<long>(t) * pagesPer * kLinks;
+            for (long p = 0; p < pagesPer; ++p)
+            {
+                for (int l = 0; l < kLinks; ++l)
+                    queue.push(Item(makeUrl(next++), 1));
+                if (queue.try_pop(item))
+                    consumed++;
+            }
+            while (consumed < total)
+            {
+                if (queue.try_pop(item))
+                    consumed++;
+                else
+                    std::this_thread::yield();
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    return total / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+static double runCrawlerPath(int threads, long pagesPer)
+{
+    UrlFrontier frontier(std::chrono::milliseconds(0), 1, kHosts);
+    std::vector<std::unique_ptr<WorkStealingDeque<Batch *>>> deques;
+    for (int t = 0; t < threads; ++t)
+        deques.push_back(std::make_unique<WorkStealingDeque<Batch *>>());
+
+    std::atomic<long> consumed{0};
+    long total = pagesPer * threads * kLinks;
+    auto start = std::chrono::steady_clock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t)
+    {
+        workers.emplace_back([&, t]() {
+            // One step of WebCrawler::workerThread: place a batch, else serve a URL
+            auto step = [&]() {
+                Batch *batch = nullptr;
+                bool took = deques[t]->pop(batch);
+                for (int i = 1; !took && i < threads; ++i)
+                    took = deques[(t + i) % threads]->steal(batch);
+                if (took)
+                {
+                    frontier.push_batch(*batch);
+                    delete batch;
+                    return true;
+                }
+                Item item;
+                if (frontier.try_pop(item))
+                {
+                    frontier.complete(item.first);
+                    consumed++;
+                    return true;
+                }
+                return false;
+            };
+
+            long next = static_cast<long>(t) * pagesPer * kLinks;
+            for (long p = 0; p < pagesPer; ++p)
+            {
+                Batch *batch = new Batch();
+                batch->reserve(kLinks);
+                for (int l = 0; l < kLinks; ++l)
+                    batch->emplace_back(makeUrl(next++), 1);
+                deques[t]->push(batch);
+                step();
+            }
+            while (consumed < total)
+            {
+                if (!step())
+                    std::this_thread::yield();
+            }
+        });
+    }
+    for (auto &worker : workers)
+        worker.join();
+    return total / std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char *argv[])
+{
+    long pages = argc > 1 ? std::strtol(argv[1], nullptr, 10) : 40000;
+    std::cout << "threads  mutex queue      crawler path" << std::endl;
+    for (int threads : {8, 32, 128})
+    {
+        long pagesPer = std::max(1L, pages / threads);
+        double mutexRate = runMutexQueue(threads, pagesPer);
+        double crawlerRate = runCrawlerPath(threads, pagesPer);
+        std::cout << threads << "\t " << mutexRate / 1e6 << " M links/s\t  " << crawlerRate / 1e6 << " M links/s"
+                  << std::endl;
+    }
+    return 0;
+}
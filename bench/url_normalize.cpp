@@ -0,0 +1,74 @@
+// Links/s through resolveUrl, which every extracted link passes before the
+// visited-set check.
+//
+//   paste:    the original baseUrl + "/" + href, as a floor for the cost
+//   resolve:  resolveUrl on the same links, relative and absolute alike
+//
+// The links mimic what pages carry: relative paths with dot segments,
+// query-only and fragment links, protocol-relative and absolute URLs with
+// mixed-case hosts, default ports and percent-escapes.
+//
+// usage: bench_url_normalize [links=2000000]
+#include "url_normalizer.h"
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <vector>
+
+static const char *kBases[] = {
+    "https://www.example.com/docs/guide/index.html",
+    "http://News.Example.org:80/2024/05/story?id=17",
+    "https://shop.example.net/catalog/shoes/",
+};
+
+static const char *kLinks[] = {
+    "page2.html",
+    "../reference/api.html#section-3",
+    "./img/../css/site.css",
+    "?page=3&sort=asc",
+    "#top",
+    "/about/team/",
+    "//cdn.Example.com/lib/app.js",
+    "https://WWW.Example.COM:443/a/b/../c/%7Euser/",
+    "HTTP://example.com/search?q=caf%c3%a9&lang=fr",
+    "item.php?id=42&ref=%2Fhome",
+    "../../../../top-level",
+    "mailto:someone@example.com",
+    "https://example.com/path%20with%20spaces/file name.pdf",
+    "category/Boots/?color=Black&size=10#reviews",
+};
+
+int main(int argc, char *argv[])
+{
+    size_t count = argc > 1 ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    const size_t bases = sizeof(kBases) / sizeof(kBases[0]);
+    const size_t links = sizeof(kLinks) / sizeof(kLinks[0]);
+    std::vector<std::string> baseUrls(kBases, kBases + bases);
+    std::vector<std::string> hrefs(kLinks, kLinks + links);
+
+    size_t checksum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string url = baseUrls[i % bases] + "/" + hrefs[i % links];
+        checksum += url.size();
+    }
+    double paste = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    size_t rejected = 0;
+    start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+    {
+        std::string url = resolveUrl(baseUrls[i % bases], hrefs[i % links]);
+        checksum += url.size();
+        rejected += url.empty();
+    }
+    double resolve = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << count << " links, " << rejected << " rejected as not http(s), checksum " << checksum << std::endl;
+    std::cout << "paste:   " << count / paste / 1e6 << " M links/s, " << paste * 1e9 / count << " ns/link" << std::endl;
+    std::cout << "resolve: " << count / resolve / 1e6 << " M links/s, " << resolve * 1e9 / count << " ns/link"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "fingerprint.h"
+
+// Cache-blocked Bloom filter: every key maps to one 512-bit block (one cache
+// line) and sets its k bits inside it, so a lookup touches a single line.
+// Sized from the expected number of keys and the false-positive budget.
+class BlockedBloomFilter
+{
+private:
+    std::vector<uint64_t> words;
+    size_t blockCount;
+    int hashCount;
+
+public:
+    BlockedBloomFilter(size_t expectedItems, double falsePositiveRate);
+    bool testAndSet(const Fingerprint128 &key);
+    bool mayContain(const Fingerprint128 &key) const;
+    size_t memoryBytes() const { return words.size() * sizeof(uint64_t); }
+    int hashes() const { return hashCount; }
+};
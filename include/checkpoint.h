@@ -0,0 +1,93 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Packed little-endian record helpers shared by the snapshot sections
+void appendU32(std::string &out, uint32_t value);
+void appendU64(std::string &out, uint64_t value);
+void appendBytes(std::string &out, const std::string &value);
+
+// Sequential reader over one mapped section. Every getter returns false
+// instead of reading past the end, so a truncated file is detected.
+struct CheckpointCursor
+{
+    const char *pos;
+    const char *end;
+
+    bool getU32(uint32_t &value);
+    bool getU64(uint64_t &value);
+    bool getBytes(std::string &value);
+};
+
+// Maps a snapshot read-only and exposes each section in place.
+// Throws std::runtime_error if the file is missing, truncated or not a snapshot.
+class CheckpointFile
+{
+private:
+    const char *data;
+    size_t length;
+    uint32_t mode;
+    uint64_t counts[4];
+    const char *sectionStart[4];
+    size_t sectionSize[4];
+
+public:
+    // The visited set, every URL accepted but not finished, per-host
+    // politeness deadlines (host key, wall-clock ms), and the frontier
+    // segment files holding the rest of the pending URLs (name, byte range)
+    enum Section
+    {
+        Visited,
+        Pending,
+        Hosts,
+        Spilled
+    };
+
+    explicit CheckpointFile(const std::string &path);
+    ~CheckpointFile();
+    CheckpointFile(const CheckpointFile &) = delete;
+    CheckpointFile &operator=(const CheckpointFile &) = delete;
+
+    uint32_t visitedMode() const { return mode; }
+    uint64_t count(Section section) const { return counts[section]; }
+    CheckpointCursor cursor(Section section) const;
+    size_t sizeBytes() const { return length; }
+};
+
+// Streams a snapshot into a temporary file one section at a time, in
+// Section order, then fills in the header, syncs the file and renames it
+// over the previous snapshot, so a crash mid-write leaves the last good one
+// in place. Records are appended to out() with the helpers above and
+// reach the file in large writes, so no section is ever held in memory
+// whole. Throws std::runtime_error on I/O failure.
+class CheckpointWriter
+{
+private:
+    std::string path;
+    std::string temp;
+    int fd;
+    uint32_t mode;
+    uint64_t counts[4] = {};
+    uint64_t sizes[4] = {};
+    size_t section = 0;
+    std::string buffer;
+    bool committed = false;
+
+    void writeBuffer();
+
+public:
+    CheckpointWriter(const std::string &path, uint32_t visitedMode);
+    ~CheckpointWriter();
+    CheckpointWriter(const CheckpointWriter &) = delete;
+    CheckpointWriter &operator=(const CheckpointWriter &) = delete;
+
+    std::string &out() { return buffer; }
+    // Counts the record just appended to out()
+    void endRecord();
+    // Moves on to the next section
+    void endSection();
+    uint64_t count(CheckpointFile::Section s) const { return counts[s]; }
+    void commit();
+};
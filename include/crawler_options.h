@@ -0,0 +1,43 @@
+#pragma once
+
+#include <string>
+#include "trap_detector.h"
+
+enum class VisitedMode
+{
+    Strings,       // Exact full URLs
+    Fingerprint64, // 64-bit URL fingerprints in a flat table
+    Fingerprint128, // 128-bit URL fingerprints in a flat table
+    Bloom          // Blocked Bloom filter in RAM, exact fingerprints on disk
+};
+
+enum class ExtractMode
+{
+    Dom,    // Gumbo parse and tree walk
+    Scan,   // Link scanner over the raw HTML, no tree
+    Compare // Both; Gumbo's result is used and differences are reported
+};
+
+struct CrawlerOptions
+{
+    int threads = 4;
+    int depth = 3;
+    int delayMs = 1000;
+    int fetchThreads = 1;
+    int maxInFlight = 1000;
+    VisitedMode visitedMode = VisitedMode::Strings;
+    size_t expectedUrls = 10000000;
+    double bloomFalsePositiveRate = 0.01;
+    std::string stateDir = "crawler_state";
+    size_t frontierMemoryBytes = size_t(512) << 20;
+    int checkpointIntervalSec = 300; // 0 disables snapshots and the write-ahead log
+    int walCommitMs = 5;
+    bool resume = false;
+    bool queryRules = true;
+    std::string queryRulesFile; // empty selects the built-in rules
+    bool trapDetection = true;
+    TrapLimits trapLimits;
+    ExtractMode extractMode = ExtractMode::Dom;
+    size_t headOnlyBytes = 0; // > 0: scan mode that stops each download this many bytes after </head>
+    bool parseArena = true; // Gumbo trees from a per-thread bump arena instead of malloc
+};
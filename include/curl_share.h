@@ -0,0 +1,50 @@
+#pragma once
+
+#include <string>
+#include <mutex>
+#include <atomic>
+#include <curl/curl.h>
+
+struct ShareStats
+{
+    size_t dnsHits = 0;
+    size_t dnsMisses = 0;
+    size_t dnsMicros = 0; // spent resolving on misses
+    size_t tlsHandshakes = 0;
+    size_t tlsMicros = 0;
+};
+
+// Crawler-wide CURLSH sharing the DNS and TLS session caches between every
+// fetch engine. Connections are not shared: curl does not support one
+// connection cache across multi handles driven from different threads, so
+// each engine's multi handle keeps its own pool. curl does not report cache hits itself, so
+// each transfer that opened a connection is classified from its own
+// timings: a name lookup that took under kDnsHitMicros came from the cache,
+// and the TLS handshake time is summed so session reuse shows up as a
+// shorter average.
+class CurlShare
+{
+private:
+    static constexpr curl_off_t kDnsHitMicros = 100;
+
+    CURLSH *share;
+    std::mutex locks[CURL_LOCK_DATA_LAST];
+    std::atomic<size_t> dnsHits{0};
+    std::atomic<size_t> dnsMisses{0};
+    std::atomic<size_t> dnsMicros{0};
+    std::atomic<size_t> tlsHandshakes{0};
+    std::atomic<size_t> tlsMicros{0};
+
+    static void lockCallback(CURL *easy, curl_lock_data data, curl_lock_access access, void *userp);
+    static void unlockCallback(CURL *easy, curl_lock_data data, void *userp);
+
+public:
+    CurlShare();
+    ~CurlShare();
+    CurlShare(const CurlShare &) = delete;
+    CurlShare &operator=(const CurlShare &) = delete;
+
+    CURLSH *handle() const;
+    void recordTransfer(CURL *easy);
+    ShareStats stats() const;
+};
@@ -0,0 +1,91 @@
+#pragma once
+
+#include <cstddef>
+#include <memory>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <shared_mutex>
+#include "fingerprint.h"
+#include "fingerprint_table.h"
+
+// Exact set of 128-bit fingerprints kept on disk as log-structured sorted
+// runs. New keys are buffered in memory; each full buffer is sorted and
+// written out as a new run file in one sequential write, and runs of
+// similar size are merged by streaming both into a new file. A key is
+// therefore never written in place, and the store is read only to answer
+// lookups. Those cost at most one page per run: the first key of every page
+// is kept in memory, so a lookup knows which page to read, and there are
+// O(log n) runs.
+//
+// flush() does the writing and merging. It never runs under the caller's
+// lock and only holds the store exclusively to swap runs in and out, so
+// lookups carry on while it works.
+//
+// The files are scratch space: leftovers are deleted when the store opens,
+// and a resumed crawl rebuilds the store from the checkpoint. Throws
+// std::runtime_error if a run file cannot be written or mapped.
+class DiskFingerprintStore
+{
+private:
+    struct Run
+    {
+        std::string path;
+        int fd = -1;
+        const Fingerprint128 *keys = nullptr;
+        size_t count = 0;
+        std::vector<Fingerprint128> fences; // first key of every page
+
+        ~Run();
+        bool contains(const Fingerprint128 &key) const;
+    };
+
+    static constexpr size_t kBufferKeys = 4096;
+    static constexpr size_t kKeysPerPage = 4096 / sizeof(Fingerprint128);
+
+    std::string prefix;
+    size_t nextRun = 0;
+    // Lock order: recentMutex, then runsMutex
+    mutable std::mutex recentMutex;
+    FingerprintTable<Fingerprint128> recent{16}; // not handed to flush() yet
+    mutable std::shared_mutex runsMutex;
+    FingerprintTable<Fingerprint128> flushing{16}; // being written out as a run
+    std::vector<std::unique_ptr<Run>> runs;        // oldest first
+    std::mutex flushMutex;
+
+    std::unique_ptr<Run> writeRun(const std::vector<Fingerprint128> &keys);
+    std::unique_ptr<Run> mergeRuns(const Run &older, const Run &newer);
+    std::unique_ptr<Run> mapRun(const std::string &path, int fd, size_t count);
+    bool containsLocked(const Fingerprint128 &key) const;
+
+public:
+    DiskFingerprintStore(const std::string &pathPrefix);
+    DiskFingerprintStore(const DiskFingerprintStore &) = delete;
+    DiskFingerprintStore &operator=(const DiskFingerprintStore &) = delete;
+
+    // Adds the key unless present; true if it was new
+    bool insert(Fingerprint128 key);
+    // Adds a key the caller knows is absent, such as a Bloom negative, without looking it up
+    void add(Fingerprint128 key);
+    bool contains(Fingerprint128 key) const;
+    // A full buffer is waiting; call flush() once the caller's own lock is released
+    bool flushDue() const;
+    void flush();
+    size_t size() const;
+    size_t diskBytes() const;
+    size_t memoryBytes() const;
+
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        std::lock_guard<std::mutex> lock(recentMutex);
+        std::shared_lock<std::shared_mutex> runsLock(runsMutex);
+        recent.forEach(visit);
+        flushing.forEach(visit);
+        for (const auto &run : runs)
+        {
+            for (size_t i = 0; i < run->count; ++i)
+                visit(run->keys[i]);
+        }
+    }
+};
@@ -0,0 +1,17 @@
+#pragma once
+
+#include <vector>
+#include <gumbo.h>
+
+// One extractor's view of a parsed page. walkDom calls visit for every
+// element in document order, then finish once, so any number of extractors
+// share a single parse and a single traversal.
+class DomVisitor
+{
+public:
+    virtual ~DomVisitor() = default;
+    virtual void visit(const GumboElement &element) = 0;
+    virtual void finish() {}
+};
+
+void walkDom(const GumboNode *root, const std::vector<DomVisitor *> &visitors);
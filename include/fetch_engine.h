@@ -0,0 +1,124 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <unordered_set>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <memory>
+#include <curl/curl.h>
+#include "mpmc_ring.h"
+#include "curl_share.h"
+#include "link_scanner.h"
+
+struct FetchRequest
+{
+    std::string url;
+    int depth;
+};
+
+struct FetchResult
+{
+    std::string url;
+    int depth;
+    std::string body;
+    CURLcode status;
+    long httpCode;
+    std::string effectiveUrl;           // where the last redirect led; empty if none was followed
+    std::vector<std::string> redirects; // Location of each redirect followed, as sent
+    bool scanned = false;               // metadata was filled while the body arrived; body is empty
+    PageMetadata metadata;
+};
+
+struct FetchStats
+{
+    size_t completed = 0;
+    size_t handlesCreated = 0;
+    size_t connectionsOpened = 0;
+    size_t connectionsReused = 0; // successful transfers that opened no connection
+    size_t scannedBytes = 0; // bodies scanned as they arrived
+    size_t scanNanos = 0;
+    size_t stoppedEarly = 0;   // head-only transfers aborted before the end of the body
+    size_t skippedNonHtml = 0; // of those, responses that were not HTML at all
+    size_t bytesSaved = 0;     // body bytes never downloaded, where Content-Length said
+    size_t savedPages = 0;     // transfers bytesSaved covers
+};
+
+// Event-driven fetcher: one thread drives many concurrent transfers through
+// curl_multi_socket_action, with socket readiness and curl's timer delivered
+// by epoll. Finished transfers are pushed onto the bounded completion ring;
+// while the ring is full no new transfers are started.
+class FetchEngine
+{
+private:
+    struct Transfer
+    {
+        CURL *easy;
+        FetchRequest request;
+        std::string body;
+        std::vector<std::string> redirects;
+        bool redirecting = false; // the response being received is a 3xx
+        FetchEngine *engine = nullptr;
+        std::unique_ptr<LinkScanner> scanner; // created at the first body byte when scanning
+        PageMetadata metadata;
+        size_t received = 0;
+        bool stoppedEarly = false;
+        bool notHtml = false; // stopped at the first byte because the Content-Type was not HTML
+    };
+
+    MpmcRing<FetchResult> &completed;
+    CurlShare *share;
+    size_t maxInFlight;
+    bool scanBodies;
+    size_t bodyBytesAfterHead; // 0 downloads whole bodies
+    CURLM *multi;
+    int epollFd;
+    int timerFd;
+    int wakeFd;
+    std::thread loopThread;
+    std::atomic<bool> stopping{false};
+    std::atomic<size_t> inFlight{0};
+    std::mutex pendingMutex;
+    std::vector<FetchRequest> pending;
+    std::unordered_set<Transfer *> active;
+    std::vector<CURL *> idleHandles;
+    std::deque<FetchResult> overflow;
+    std::atomic<size_t> completedCount{0};
+    std::atomic<size_t> handlesCreated{0};
+    std::atomic<size_t> connectionsOpened{0};
+    std::atomic<size_t> connectionsReused{0};
+    std::atomic<size_t> scannedBytes{0};
+    std::atomic<size_t> scanNanos{0};
+    std::atomic<size_t> stoppedEarly{0};
+    std::atomic<size_t> skippedNonHtml{0};
+    std::atomic<size_t> bytesSaved{0};
+    std::atomic<size_t> savedPages{0};
+
+    static size_t WriteCallback(void *contents, size_t size, size_t nmemb, void *userp);
+    static size_t HeaderCallback(char *buffer, size_t size, size_t nitems, void *userp);
+    static int socketCallback(CURL *easy, curl_socket_t fd, int what, void *userp, void *socketp);
+    static int timerCallback(CURLM *multi, long timeoutMs, void *userp);
+    CURL *acquireHandle();
+    void releaseHandle(CURL *curl);
+    void run();
+    void addPending();
+    void fail(FetchRequest request, CURLcode status);
+    void drainCompleted();
+    bool flushOverflow();
+
+public:
+    // With scanWhileReceiving, every body is fed to a LinkScanner chunk by
+    // chunk on the event loop, and results carry metadata instead of a body.
+    // A nonzero headOnlyBytes (which implies scanning) then also stops each
+    // transfer that many bytes after </head>, and skips non-HTML bodies.
+    FetchEngine(MpmcRing<FetchResult> &completedQueue, CurlShare *curlShare = nullptr, size_t maxTransfers = 1000,
+                bool scanWhileReceiving = false, size_t headOnlyBytes = 0);
+    ~FetchEngine();
+    void start();
+    void stop();
+    void submit(FetchRequest request);
+    bool idle();
+    FetchStats stats() const;
+};
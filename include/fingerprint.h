@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+struct Fingerprint128
+{
+    uint64_t lo;
+    uint64_t hi;
+
+    bool operator==(const Fingerprint128 &other) const { return lo == other.lo && hi == other.hi; }
+};
+
+// MurmurHash3 x64 128-bit. The 64-bit fingerprint is the low half.
+Fingerprint128 fingerprint128(const char *data, size_t length, uint32_t seed = 0);
+
+inline Fingerprint128 fingerprint128(const std::string &text)
+{
+    return fingerprint128(text.data(), text.size());
+}
+
+inline uint64_t fingerprint64(const std::string &text)
+{
+    return fingerprint128(text.data(), text.size()).lo;
+}
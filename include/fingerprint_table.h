@@ -0,0 +1,104 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+#include "fingerprint.h"
+
+// Open-addressing set of fingerprints with linear probing. Keys are stored
+// inline in one flat array; the all-zero key marks an empty slot, so a zero
+// fingerprint is nudged to 1 on the way in.
+template <typename Key>
+class FingerprintTable
+{
+private:
+    std::vector<Key> slots;
+    size_t count = 0;
+
+    static bool isEmpty(uint64_t key) { return key == 0; }
+    static bool isEmpty(const Fingerprint128 &key) { return key.lo == 0 && key.hi == 0; }
+    static uint64_t probeBits(uint64_t key) { return key; }
+    static uint64_t probeBits(const Fingerprint128 &key) { return key.lo; }
+    static void normalize(uint64_t &key) { key += key == 0; }
+    static void normalize(Fingerprint128 &key) { key.lo += (key.lo == 0 && key.hi == 0); }
+    void grow();
+
+public:
+    explicit FingerprintTable(size_t initialCapacity = 1024);
+    bool insert(Key key);
+    bool contains(Key key) const;
+    size_t size() const { return count; }
+    size_t memoryBytes() const { return slots.capacity() * sizeof(Key); }
+
+    template <typename Visitor>
+    void forEach(Visitor visit) const
+    {
+        for (const Key &key : slots)
+        {
+            if (!isEmpty(key))
+                visit(key);
+        }
+    }
+};
+
+template <typename Key>
+FingerprintTable<Key>::FingerprintTable(size_t initialCapacity)
+{
+    size_t capacity = 16;
+    while (capacity < initialCapacity)
+        capacity <<= 1;
+    slots.assign(capacity, Key{});
+}
+
+template <typename Key>
+void FingerprintTable<Key>::grow()
+{
+    std::vector<Key> old(slots.size() * 2, Key{});
+    old.swap(slots);
+    size_t mask = slots.size() - 1;
+    for (const Key &key : old)
+    {
+        if (isEmpty(key))
+            continue;
+        size_t i = probeBits(key) & mask;
+        while (!isEmpty(slots[i]))
+            i = (i + 1) & mask;
+        slots[i] = key;
+    }
+}
+
+template <typename Key>
+bool FingerprintTable<Key>::insert(Key key)
+{
+    normalize(key);
+    // Keep the load factor under 0.7 so probe chains stay short
+    if ((count + 1) * 10 > slots.size() * 7)
+        grow();
+
+    size_t mask = slots.size() - 1;
+    size_t i = probeBits(key) & mask;
+    while (!isEmpty(slots[i]))
+    {
+        if (slots[i] == key)
+            return false;
+        i = (i + 1) & mask;
+    }
+    slots[i] = key;
+    count++;
+    return true;
+}
+
+template <typename Key>
+bool FingerprintTable<Key>::contains(Key key) const
+{
+    normalize(key);
+    size_t mask = slots.size() - 1;
+    size_t i = probeBits(key) & mask;
+    while (!isEmpty(slots[i]))
+    {
+        if (slots[i] == key)
+            return true;
+        i = (i + 1) & mask;
+    }
+    return false;
+}
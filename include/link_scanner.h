@@ -0,0 +1,90 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "page_metadata.h"
+
+// Link-discovery fast path: fills the same PageMetadata fields as the Gumbo
+// extractors straight from the raw HTML, without building a tree. Tag starts
+// are located with AVX2 or SSE2 byte search where the CPU has it, otherwise
+// with a scalar loop. It follows the tokenizer rules that matter for those
+// fields: comments, raw-text elements such as <script>, quoted attributes,
+// the first of two same-named attributes winning, and the common character
+// references.
+//
+// The document can arrive in chunks of any size. Each feed consumes
+// everything up to a tag that is cut off by the end of the chunk and keeps
+// only that tail, so links are resolved while the rest is still on the
+// wire. The tail is not parsed again from its start: the next feed picks up
+// at the attribute or search position where the last one stopped. metadata.url must be set before the first feed.
+class LinkScanner
+{
+private:
+    enum class State
+    {
+        Markup,
+        Comment,
+        RawText,
+        Plaintext
+    };
+
+    PageMetadata &metadata;
+    size_t (*find)(const char *p, size_t from, size_t n, char c);
+    std::string pending; // unconsumed tail of the previous chunk
+    // How far the construct cut off at the start of pending was already
+    // parsed, as offsets from its '<', so the next chunk continues from there
+    struct Progress
+    {
+        size_t attribute = 0; // start tag: first attribute not fully parsed, 0 if none were
+        size_t searched = 0;  // bytes already searched for the end of a value or for '>'
+        bool found[2] = {false, false};
+        size_t valueBegin[2] = {0, 0};
+        size_t valueEnd[2] = {0, 0};
+    };
+    Progress progress;
+    State state = State::Markup;
+    std::string rawTextTag; // lowercase name whose end tag leaves RawText
+    bool capturingTitle = false;
+    std::string titleText; // raw, decoded once the title is closed
+    bool haveTitle = false;
+    bool haveDescription = false;
+    bool haveBase = false;
+    std::string baseUrl;
+    // Hrefs seen before any <base>; a later <base> changes how they resolve
+    std::vector<std::string> rawHrefs;
+    bool haveCanonical = false;
+    std::string rawCanonical;
+    std::string scratch[2];
+    size_t fedBytes = 0;
+    size_t bufferOffset = 0; // document offset of the buffer being scanned
+    size_t headEndOffset = std::string::npos;
+
+    std::string_view text(std::string_view raw, int slot);
+    size_t scan(const char *p, size_t n, bool final);
+    size_t startTag(const char *p, size_t i, size_t n, bool final, const Progress *resume);
+    void addHref(std::string_view href);
+    void setBase(std::string_view href);
+    void endHead(size_t at);
+
+public:
+    explicit LinkScanner(PageMetadata &page);
+    void feed(const char *data, size_t size);
+    // End of document: flushes the tail, fills defaults, resolves the canonical URL
+    void finish();
+    // Document offset of the tag that closed <head> (</head>, <body>, or any
+    // tag that cannot appear in a head), or npos while still in the head.
+    // Text in the head is not checked, so a head ended only by text is
+    // seen at the next tag instead.
+    size_t headEnd() const { return headEndOffset; }
+};
+
+// One-shot scan of a complete document
+void scanPage(const std::string &html, PageMetadata &metadata);
+
+// Byte search in use: "avx2", "sse2" or "scalar"
+const char *linkScannerIsa();
+
+// Forces one byte search; returns false if the name is unknown or the CPU
+// lacks it. Meant for comparing the implementations.
+bool selectLinkScannerIsa(const std::string &name);
@@ -0,0 +1,230 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+
+// Bounded lock-free multi-producer/multi-consumer ring (Vyukov's sequence
+// counter design). Every cell and both cursors sit on their own cache line.
+// push fails instead of growing when the ring is full, which is what gives
+// producers backpressure. wait_pop only takes a lock once the ring is empty,
+// and a producer only touches that lock when a consumer is actually asleep.
+template <typename T>
+class MpmcRing
+{
+private:
+    struct alignas(64) Cell
+    {
+        std::atomic<size_t> sequence;
+        T data;
+    };
+
+    Cell *cells;
+    size_t mask;
+    alignas(64) std::atomic<size_t> enqueuePos{0};
+    alignas(64) std::atomic<size_t> dequeuePos{0};
+    alignas(64) std::atomic<int> sleepers{0};
+    std::atomic<bool> cancelled{false};
+    std::mutex sleepMutex;
+    std::condition_variable sleepCond;
+
+    void wakeSleepers(size_t count);
+
+public:
+    explicit MpmcRing(size_t capacity);
+    ~MpmcRing();
+    MpmcRing(const MpmcRing &) = delete;
+    MpmcRing &operator=(const MpmcRing &) = delete;
+
+    bool push(T &&value);
+    bool try_pop(T &value);
+    size_t push_n(T *values, size_t count);
+    size_t pop_n(T *values, size_t count);
+    bool wait_pop(T &value, std::chrono::milliseconds timeout);
+    void cancel();
+    bool empty() const;
+    size_t size() const;
+    size_t capacity() const;
+};
+
+template <typename T>
+MpmcRing<T>::MpmcRing(size_t capacity)
+{
+    size_t cap = 2;
+    while (cap < capacity)
+        cap <<= 1;
+    cells = new Cell[cap];
+    mask = cap - 1;
+    for (size_t i = 0; i < cap; ++i)
+    {
+        cells[i].sequence.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T>
+MpmcRing<T>::~MpmcRing()
+{
+    delete[] cells;
+}
+
+template <typename T>
+void MpmcRing<T>::wakeSleepers(size_t count)
+{
+    // Pairs with the increment in wait_pop: either the sleeper sees the new
+    // item before waiting, or we see the sleeper and notify under its lock
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleepers.load(std::memory_order_relaxed) > 0)
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        if (count == 1)
+            sleepCond.notify_one();
+        else
+            sleepCond.notify_all();
+    }
+}
+
+// On failure the value is left untouched so the caller can retry it
+template <typename T>
+bool MpmcRing<T>::push(T &&value)
+{
+    return push_n(&value, 1) == 1;
+}
+
+template <typename T>
+bool MpmcRing<T>::try_pop(T &value)
+{
+    return pop_n(&value, 1) == 1;
+}
+
+template <typename T>
+size_t MpmcRing<T>::push_n(T *values, size_t count)
+{
+    size_t pos = enqueuePos.load(std::memory_order_relaxed);
+    size_t claimed = 0;
+    for (;;)
+    {
+        // Count how many consecutive cells are free from pos onwards
+        claimed = 0;
+        while (claimed < count)
+        {
+            Cell &cell = cells[(pos + claimed) & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            if (seq != pos + claimed)
+                break;
+            claimed++;
+        }
+
+        if (claimed == 0)
+        {
+            Cell &cell = cells[pos & mask];
+            intptr_t diff = static_cast<intptr_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos);
+            if (diff < 0)
+                return 0; // Full
+            pos = enqueuePos.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (enqueuePos.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed))
+            break;
+    }
+
+    for (size_t i = 0; i < claimed; ++i)
+    {
+        Cell &cell = cells[(pos + i) & mask];
+        cell.data = std::move(values[i]);
+        cell.sequence.store(pos + i + 1, std::memory_order_release);
+    }
+    wakeSleepers(claimed);
+    return claimed;
+}
+
+template <typename T>
+size_t MpmcRing<T>::pop_n(T *values, size_t count)
+{
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    size_t claimed = 0;
+    for (;;)
+    {
+        claimed = 0;
+        while (claimed < count)
+        {
+            Cell &cell = cells[(pos + claimed) & mask];
+            size_t seq = cell.sequence.load(std::memory_order_acquire);
+            if (seq != pos + claimed + 1)
+                break;
+            claimed++;
+        }
+
+        if (claimed == 0)
+        {
+            Cell &cell = cells[pos & mask];
+            intptr_t diff = static_cast<intptr_t>(cell.sequence.load(std::memory_order_acquire)) - static_cast<intptr_t>(pos + 1);
+            if (diff < 0)
+                return 0; // Empty
+            pos = dequeuePos.load(std::memory_order_relaxed);
+            continue;
+        }
+
+        if (dequeuePos.compare_exchange_weak(pos, pos + claimed, std::memory_order_relaxed))
+            break;
+    }
+
+    for (size_t i = 0; i < claimed; ++i)
+    {
+        Cell &cell = cells[(pos + i) & mask];
+        values[i] = std::move(cell.data);
+        cell.sequence.store(pos + i + mask + 1, std::memory_order_release);
+    }
+    return claimed;
+}
+
+template <typename T>
+bool MpmcRing<T>::wait_pop(T &value, std::chrono::milliseconds timeout)
+{
+    if (try_pop(value))
+    {
+        return true;
+    }
+
+    std::unique_lock<std::mutex> lock(sleepMutex);
+    sleepers.fetch_add(1, std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    sleepCond.wait_for(lock, timeout, [this] { return !empty() || cancelled.load(); });
+    sleepers.fetch_sub(1, std::memory_order_relaxed);
+    lock.unlock();
+    return try_pop(value);
+}
+
+template <typename T>
+void MpmcRing<T>::cancel()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleepMutex);
+        cancelled = true;
+    }
+    sleepCond.notify_all();
+}
+
+template <typename T>
+bool MpmcRing<T>::empty() const
+{
+    size_t pos = dequeuePos.load(std::memory_order_relaxed);
+    return cells[pos & mask].sequence.load(std::memory_order_acquire) != pos + 1;
+}
+
+template <typename T>
+size_t MpmcRing<T>::size() const
+{
+    size_t tail = dequeuePos.load(std::memory_order_relaxed);
+    size_t head = enqueuePos.load(std::memory_order_relaxed);
+    return head > tail ? head - tail : 0;
+}
+
+template <typename T>
+size_t MpmcRing<T>::capacity() const
+{
+    return mask + 1;
+}
@@ -0,0 +1,79 @@
+#pragma once
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include "dom_visitor.h"
+#include "page_metadata.h"
+
+// True if the space- or comma-separated list holds token, ignoring case
+bool hasToken(std::string_view list, std::string_view token);
+
+// Resolves raw hrefs and the canonical href into metadata, against the
+// <base href> if one was seen and the page URL otherwise. An absent base or
+// canonical is a default-constructed view; an empty attribute is not.
+void resolvePageLinks(PageMetadata &metadata, std::string_view base, const std::vector<std::string_view> &hrefs,
+                      std::string_view canonical);
+
+// The extractors behind PageMetadata. Each fills its fields of the
+// metadata it was given during one walkDom pass.
+
+// First <title>, or "No title"
+class TitleExtractor : public DomVisitor
+{
+private:
+    PageMetadata &metadata;
+    bool found = false;
+
+public:
+    explicit TitleExtractor(PageMetadata &page) : metadata(page) {}
+    void visit(const GumboElement &element) override;
+    void finish() override;
+};
+
+// First <meta name=description>, or "No description"
+class DescriptionExtractor : public DomVisitor
+{
+private:
+    PageMetadata &metadata;
+    bool found = false;
+
+public:
+    explicit DescriptionExtractor(PageMetadata &page) : metadata(page) {}
+    void visit(const GumboElement &element) override;
+    void finish() override;
+};
+
+// <meta name=robots> noindex/nofollow/none
+class RobotsExtractor : public DomVisitor
+{
+private:
+    PageMetadata &metadata;
+
+public:
+    explicit RobotsExtractor(PageMetadata &page) : metadata(page) {}
+    void visit(const GumboElement &element) override;
+};
+
+// <a href> links except rel=nofollow, and <link rel=canonical>. Hrefs are
+// resolved in finish, against the first <base href> wherever it appears.
+class LinkExtractor : public DomVisitor
+{
+private:
+    PageMetadata &metadata;
+    // Views into the parse, which outlives the walk
+    std::vector<std::string_view> hrefs;
+    std::string_view base;
+    std::string_view canonical;
+
+public:
+    explicit LinkExtractor(PageMetadata &page) : metadata(page) {}
+    void visit(const GumboElement &element) override;
+    void finish() override;
+};
+
+class ParseArena;
+
+// Parses html with Gumbo once and runs every extractor above over the tree.
+// With an arena the tree is allocated from it and dropped by one reset.
+void extractPage(const std::string &html, PageMetadata &metadata, ParseArena *arena = nullptr);
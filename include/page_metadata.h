@@ -10,4 +10,9 @@ struct PageMetadata
     std::string description;
     std::vector<std::string> links;
     int depth;
-};
\ No newline at end of file
+    std::string canonical; // <link rel=canonical>, resolved; empty if absent
+    bool noindex = false;  // <meta name=robots content=noindex|none>
+    bool nofollow = false; // <meta name=robots content=nofollow|none>
+    size_t nofollowLinks = 0; // <a rel=nofollow> links left out of links
+    std::vector<std::string> redirectedFrom; // requested URL and any intermediate hops
+};
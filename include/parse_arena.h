@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <vector>
+
+struct ArenaStats
+{
+    size_t pages = 0;
+    size_t allocations = 0;
+    size_t bytes = 0;         // handed out, including space later given back by Gumbo
+    size_t largestPage = 0;   // most bytes one page needed
+};
+
+// Bump allocator for one parse at a time, plugged into Gumbo through
+// GumboOptions.allocator/deallocator. Frees are ignored and reset() drops
+// the whole page at once, so the tree never has to be walked to destroy
+// it. After a page outgrows the first block the next reset replaces the
+// blocks with one of the combined size (up to kMaxRetained), so steady
+// state is a single block and reset is O(1).
+class ParseArena
+{
+private:
+    std::vector<std::unique_ptr<char[]>> blocks;
+    std::vector<size_t> blockSizes;
+    char *cursor = nullptr;
+    char *limit = nullptr;
+    size_t pageAllocations = 0;
+    size_t pageBytes = 0;
+    // Running totals for this arena. Only the owning thread writes them;
+    // stats() reads them from the reporting thread
+    std::atomic<size_t> pages{0};
+    std::atomic<size_t> allocations{0};
+    std::atomic<size_t> bytes{0};
+    std::atomic<size_t> largestPage{0};
+
+    void *allocateSlow(size_t size);
+
+public:
+    static constexpr size_t kInitialBlock = 256 << 10;
+    static constexpr size_t kMaxRetained = 16 << 20;
+
+    ParseArena();
+    ~ParseArena();
+    ParseArena(const ParseArena &) = delete;
+    ParseArena &operator=(const ParseArena &) = delete;
+
+    void *allocate(size_t size)
+    {
+        size = (size + 15) & ~size_t(15);
+        pageAllocations++;
+        pageBytes += size;
+        if (static_cast<size_t>(limit - cursor) < size)
+            return allocateSlow(size);
+        void *result = cursor;
+        cursor += size;
+        return result;
+    }
+    void reset();
+
+    // Adapters with the GumboAllocatorFunction/GumboDeallocatorFunction signatures
+    static void *gumboAllocate(void *arena, size_t size) { return static_cast<ParseArena *>(arena)->allocate(size); }
+    static void gumboDeallocate(void *, void *) {}
+
+    // This thread's arena
+    static ParseArena &local();
+    // Totals over every page parsed in any thread, summed on each call
+    static ArenaStats stats();
+};
@@ -0,0 +1,66 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <atomic>
+#include <memory>
+#include <cstdint>
+
+struct QueryRuleStats
+{
+    std::string rule;
+    size_t rewritten = 0; // URLs this rule changed
+    size_t collapsed = 0; // of those, URLs that then turned out to be already seen
+};
+
+// Per-host rules that rewrite query strings before deduplication, so that
+// tracking parameters, session IDs and parameter order do not make one page
+// look like many. A rules file holds one rule per line:
+//
+//   <host> drop <parameter>   remove the parameter (a trailing * matches a
+//                             prefix); also removes ;name=value path parameters
+//   <host> sort               order the remaining parameters by name,
+//                             keeping repeated names in their original order
+//
+// <host> is * for every host, or a host name that also covers its
+// subdomains. Host and parameter names compare case-insensitively; # starts
+// a comment.
+class QueryRules
+{
+public:
+    enum class Action
+    {
+        Drop,
+        Sort
+    };
+
+    struct Rule
+    {
+        std::string host;
+        Action action;
+        std::string parameter;
+        bool prefix;
+        std::string text;
+    };
+
+    // Rules are returned as a bit mask, so at most this many can be loaded
+    static const size_t kMaxRules = 64;
+
+    // An empty path selects the built-in defaults. Throws std::runtime_error
+    // if the file cannot be read or a line does not parse.
+    explicit QueryRules(const std::string &path = "");
+
+    // Rewrites url in place; returns the mask of rules that changed it
+    uint64_t apply(std::string &url) const;
+    // Credits the rules in mask with a URL that was dropped as a duplicate
+    void recordCollapsed(uint64_t mask);
+    std::vector<QueryRuleStats> stats() const;
+    size_t size() const { return rules.size(); }
+
+private:
+    std::vector<Rule> rules;
+    std::unique_ptr<std::atomic<size_t>[]> rewritten;
+    std::unique_ptr<std::atomic<size_t>[]> collapsed;
+
+    void addRule(const std::string &line, size_t lineNumber);
+};
@@ -0,0 +1,76 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <vector>
+#include <fstream>
+#include <cstddef>
+#include <cstdint>
+
+struct SpillStats
+{
+    size_t spilledItems = 0;
+    size_t spilledBytes = 0;
+    double spillSeconds = 0;
+    size_t refilledItems = 0;
+    size_t refilledBytes = 0;
+    double refillSeconds = 0;
+};
+
+// Byte range of a segment file that a snapshot refers to by name
+struct SpillRange
+{
+    std::string path;
+    uint64_t begin = 0;
+    uint64_t end = 0;
+};
+
+// FIFO of (url, depth) whose head lives in memory and whose overflow is
+// appended to segment files on disk. Once anything has spilled, later pushes
+// also go to disk so order is kept; pop reads the oldest segment back
+// sequentially in batches when the in-memory head runs dry. Not thread safe;
+// the owning frontier serializes access.
+class SpillQueue
+{
+public:
+    using Item = std::pair<std::string, int>;
+
+private:
+    std::string pathPrefix;
+    std::deque<Item> head;
+    std::deque<std::string> segments;
+    std::ofstream writer;
+    std::ifstream reader;
+    size_t writerBytes = 0;
+    size_t nextSegment = 0;
+    size_t onDisk = 0;
+    size_t headBytes = 0;
+    size_t segmentBytes;
+    SpillStats stats;
+
+    bool spill(const Item &item);
+    void refill();
+
+public:
+    SpillQueue(const std::string &prefix, size_t maxSegmentBytes = 64 << 20);
+    ~SpillQueue();
+    SpillQueue(SpillQueue &&) = default;
+
+    // Returns false when the item stayed in memory
+    bool push(Item item, bool toDisk);
+    bool pop(Item &item);
+    // Puts back an item pop just returned, so it is the next one out again
+    void unpop(Item item);
+    // Appends the in-memory items to out in FIFO order. Items on disk are not
+    // read back: each segment is hard-linked as linkPrefix_N.seg, which keeps
+    // its bytes after the queue deletes it, and the unread range is recorded.
+    // Throws std::runtime_error if a link cannot be made.
+    void snapshot(std::vector<Item> &out, const std::string &linkPrefix, std::vector<SpillRange> &spilled);
+    // Reads back the items of a recorded range; false if the file is short
+    static bool load(const SpillRange &range, std::vector<Item> &out);
+    bool empty() const { return head.empty() && onDisk == 0; }
+    size_t size() const { return head.size() + onDisk; }
+    size_t memoryBytes() const { return headBytes; }
+    static size_t itemBytes(const Item &item) { return sizeof(Item) + item.first.size(); }
+    const SpillStats &spillStats() const { return stats; }
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <unordered_map>
+
+struct TrapLimits
+{
+    size_t maxUrlLength = 1024;
+    size_t maxSegmentRepeats = 2;     // a path segment may occur this often
+    size_t maxPatternFanout = 1000;   // new URLs per host and path pattern
+    size_t quarantineAfter = 200;     // trap rejections before a pattern is quarantined
+};
+
+struct TrapStats
+{
+    size_t tooLong = 0;
+    size_t repeatedSegments = 0;
+    size_t patternFanout = 0;
+    size_t quarantined = 0; // URLs dropped because their pattern was quarantined
+    size_t trappedPatterns = 0;
+    size_t quarantinedPatterns = 0;
+};
+
+// Rejects new links that look like crawler traps before they are enqueued:
+// overlong URLs, paths that repeat a segment (/a/b/a/b/a/...), and path
+// patterns (host, digit runs folded, query values dropped) that keep
+// producing new URLs, such as calendars. A pattern that trips the checks
+// too often is quarantined and none of its new links are accepted; the
+// rest of its host is crawled as usual.
+class TrapDetector
+{
+private:
+    struct PatternState
+    {
+        uint32_t admitted = 0; // saturates at the fan-out limit
+        uint32_t rejections = 0;
+        bool quarantined = false;
+    };
+
+    TrapLimits limits;
+    mutable std::mutex mutex;
+    std::unordered_map<uint64_t, PatternState> patterns;
+    TrapStats counters;
+
+    static uint64_t patternKey(const std::string &url);
+    bool repeatsSegment(const std::string &url) const;
+    void reject(PatternState &pattern, size_t &counter);
+
+public:
+    explicit TrapDetector(const TrapLimits &trapLimits);
+
+    // Takes the visited set's verdict for each link and returns one flag per
+    // link: true for links that were new and should be enqueued. Links that
+    // were not new are left out entirely, so pages repeating the same links
+    // never count toward a pattern's fan-out or quarantine.
+    std::vector<bool> check(const std::vector<std::string> &links, const std::vector<bool> &added);
+    TrapStats stats() const;
+};
@@ -0,0 +1,128 @@
+#pragma once
+
+#include <string>
+#include <deque>
+#include <queue>
+#include <vector>
+#include <mutex>
+#include <atomic>
+#include <chrono>
+#include <unordered_map>
+#include <cstdint>
+#include "spill_queue.h"
+
+// Mercator-style two-level URL frontier.
+//
+// Front queues order URLs by priority (shallower pages first). Back queues
+// hold URLs for exactly one host each, and a host owns at most one back
+// queue at a time. A min-heap keyed on each back queue's next allowed
+// request time decides which host is served, so try_pop only returns a URL
+// whose host is due. When a back queue drains, it is refilled from the
+// front queues with a new host. A host with many links therefore holds one
+// slot and never buries the others.
+//
+// Memory is bounded: once the URLs held in memory, back queues included,
+// plus the URLs dispatched but not completed and the per-host politeness
+// deadlines exceed the ceiling, front queues spill new arrivals to
+// append-only segment files and read them back sequentially as the
+// in-memory window drains. Back queues are capped, so a busy host's URLs
+// stay in the front queues rather than being pulled into memory ahead of
+// their turn; those refill meets are parked with the host while memory
+// allows, and a host's deadline is forgotten once it has passed and
+// the host holds no back queue. Dispatched URLs cannot spill, so with more
+// in flight than the ceiling allows memory exceeds it by that amount.
+//
+// push_batch never takes the frontier lock. Batches land in one of several
+// inboxes, picked per thread, and try_pop moves them into the front queues
+// under the lock it already holds, so producers only contend with the few
+// threads that share their inbox.
+class UrlFrontier
+{
+public:
+    using Item = std::pair<std::string, int>;
+
+private:
+    using Clock = std::chrono::steady_clock;
+
+    struct BackQueue
+    {
+        uint64_t host = 0;
+        std::deque<Item> urls;
+        // URLs refill found for this host while urls was full; each one
+        // try_pop takes from urls is replaced from here
+        std::deque<Item> parked;
+    };
+
+    struct ReadyEntry
+    {
+        Clock::time_point due;
+        size_t queue;
+        bool operator>(const ReadyEntry &other) const { return due > other.due; }
+    };
+
+    struct alignas(64) Inbox
+    {
+        std::mutex mutex;
+        std::vector<Item> items;
+    };
+
+    // A back queue holds at most kBackQueueItems URLs, and refill looks at
+    // no more than kRefillScan front URLs while finding a new host
+    static constexpr size_t kBackQueueItems = 64;
+    static constexpr size_t kRefillScan = 256;
+    static constexpr size_t kInboxes = 16;
+    // Rough heap cost of a hash map node beyond its value: next pointer,
+    // bucket slot and allocator header
+    static constexpr size_t kMapNodeBytes = 32;
+    // Expired deadlines are swept once the map has doubled since the last sweep
+    static constexpr size_t kMinHostSweep = 4096;
+    Inbox inboxes[kInboxes];
+    std::atomic<size_t> inboxCount{0};
+
+    mutable std::mutex mutex;
+    std::vector<SpillQueue> frontQueues;
+    std::vector<BackQueue> backQueues;
+    std::vector<size_t> freeBackQueues;
+    // Hosts are keyed by UrlView::hostKey, so no host name is ever copied
+    std::unordered_map<uint64_t, size_t> hostToBackQueue;
+    std::unordered_map<uint64_t, Clock::time_point> hostNextAllowed;
+    // URLs handed out by try_pop whose processing has not completed yet
+    std::unordered_map<std::string, int> dispatched;
+    size_t dispatchedBytes = 0;
+    size_t hostSweepAt = kMinHostSweep;
+    std::priority_queue<ReadyEntry, std::vector<ReadyEntry>, std::greater<ReadyEntry>> readyHeap;
+    std::chrono::milliseconds hostDelay;
+    size_t count = 0;
+    size_t memoryCeiling;
+    size_t backBytes = 0; // back queues, parked URLs included
+
+    size_t frontQueueFor(const Item &item) const;
+    bool popFront(Item &item);
+    void pushFront(Item item);
+    size_t memoryBytes() const;
+    void refill(size_t queue);
+    void drainInboxes();
+    void fillFreeBackQueues();
+    void expireHosts(Clock::time_point now);
+
+public:
+    UrlFrontier(std::chrono::milliseconds delay, size_t frontQueueCount, size_t backQueueCount,
+                size_t memoryLimit = 0, const std::string &spillDir = "crawler_state");
+    void push(std::pair<std::string, int> item);
+    void push_batch(std::vector<std::pair<std::string, int>> &items);
+    bool try_pop(std::pair<std::string, int> &item);
+    bool empty() const;
+    size_t size() const;
+    std::chrono::steady_clock::time_point nextDue() const;
+    SpillStats spillStats() const;
+    void complete(const std::string &url);
+
+    // Copies every queued and dispatched URL held in memory plus the hosts
+    // still inside their politeness delay, as wall-clock deadlines, under one
+    // lock. Spilled URLs are not read back: their segments are linked under
+    // spillLinkPrefix and listed in spilled (see SpillQueue::snapshot).
+    void snapshot(std::vector<Item> &items,
+                  std::vector<std::pair<uint64_t, std::chrono::system_clock::time_point>> &hostDeadlines,
+                  const std::string &spillLinkPrefix, std::vector<SpillRange> &spilled);
+    void restoreHost(uint64_t host, std::chrono::system_clock::time_point deadline);
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <string>
+
+// Resolves a link against the page it was found on (RFC 3986 section 5.2)
+// and returns it in normal form, or an empty string if the result is not an
+// http or https URL. Normal form means a lowercase scheme and host, no
+// default port, no dot segments, no fragment, "/" for an empty path, and
+// percent-encoding with uppercase hex that leaves unreserved characters
+// decoded and encodes bytes that may not appear raw.
+std::string resolveUrl(const std::string &base, const std::string &reference);
+
+// Normal form of an absolute URL, or an empty string if it is not http(s)
+std::string normalizeUrl(const std::string &url);
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <cstdint>
+#include <string_view>
+
+// Parts of an absolute URL as offsets into the caller's string. Parsing is
+// a single scan and never allocates; the accessors return views into the
+// original text, which must outlive the UrlView. The host excludes any
+// userinfo and port.
+class UrlView
+{
+private:
+    std::string_view text;
+    uint32_t schemeEnd = 0;
+    uint32_t hostBegin = 0;
+    uint32_t hostEnd = 0;
+    uint32_t portEnd = 0;
+    uint32_t pathEnd = 0;
+    uint32_t queryEnd = 0;
+    bool parsed = false;
+
+public:
+    UrlView() = default;
+    explicit UrlView(std::string_view url);
+
+    bool valid() const { return parsed; }
+    std::string_view scheme() const { return text.substr(0, schemeEnd); }
+    std::string_view host() const { return text.substr(hostBegin, hostEnd - hostBegin); }
+    // Empty when the URL has no explicit port
+    std::string_view port() const { return hostEnd < portEnd ? text.substr(hostEnd + 1, portEnd - hostEnd - 1) : std::string_view(); }
+    std::string_view path() const { return text.substr(portEnd, pathEnd - portEnd); }
+    std::string_view query() const { return pathEnd < queryEnd ? text.substr(pathEnd + 1, queryEnd - pathEnd - 1) : std::string_view(); }
+
+    // Stable 64-bit fingerprint of the host, used as the per-host map key
+    // so no module has to copy the host name out of the URL
+    uint64_t hostKey() const;
+};
@@ -1,5 +0,0 @@
-#pragma once
-
-#include <string>
-
-std::string getDomain(const std::string& url);
\ No newline at end of file
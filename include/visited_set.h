@@ -0,0 +1,80 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <memory>
+#include <unordered_set>
+#include "crawler_options.h"
+#include "fingerprint_table.h"
+#include "bloom_filter.h"
+#include "disk_fingerprint_store.h"
+#include "checkpoint.h"
+
+struct VisitedStats
+{
+    size_t urls = 0;
+    size_t memoryBytes = 0;
+    size_t diskBytes = 0;
+    size_t bloomPositives = 0;
+    size_t bloomFalsePositives = 0;
+    // Expected number of distinct URLs wrongly reported as seen because
+    // their fingerprint collided (birthday bound), zero for exact mode
+    double expectedCollisions = 0;
+};
+
+// Concurrent set of seen URLs, sharded by URL hash with one lock per shard.
+// insert_batch deduplicates a whole page's links while taking each shard's
+// lock at most once. In the fingerprint modes only a 64- or 128-bit hash of
+// each URL is kept, in a flat open-addressing table per shard. In Bloom mode
+// each shard answers from a blocked Bloom filter first and only looks a key
+// up in its on-disk exact fingerprint store when the filter reports a
+// positive; negatives are only buffered, and reach disk in sequential runs.
+class VisitedSet
+{
+private:
+    struct alignas(64) Shard
+    {
+        std::mutex mutex;
+        std::unordered_set<std::string> urls;
+        FingerprintTable<uint64_t> fingerprints64{16};
+        FingerprintTable<Fingerprint128> fingerprints128{16};
+        std::unique_ptr<BlockedBloomFilter> bloom;
+        std::unique_ptr<DiskFingerprintStore> disk;
+        size_t bloomPositives = 0;
+        size_t bloomFalsePositives = 0;
+    };
+
+    struct Key
+    {
+        size_t shard;
+        Fingerprint128 fingerprint;
+    };
+
+    std::unique_ptr<Shard[]> shards;
+    size_t shardBits;
+    VisitedMode mode;
+
+    size_t shardFor(uint64_t hash) const;
+    Key keyFor(const std::string &url) const;
+    bool insertLocked(Shard &shard, const std::string &url, const Key &key);
+    void flushIfDue(Shard &shard);
+
+public:
+    explicit VisitedSet(size_t shardCount = 64, VisitedMode visitedMode = VisitedMode::Strings,
+                        size_t expectedUrls = 0, double falsePositiveRate = 0.01, const std::string &stateDir = "");
+    bool insert(const std::string &url);
+    std::vector<bool> insert_batch(const std::vector<std::string> &urls);
+    bool contains(const std::string &url) const;
+    size_t size() const;
+    VisitedStats stats() const;
+    VisitedMode visitedMode() const { return mode; }
+
+    // Streams every member into the writer's current section one shard at a
+    // time, so inserts into the other shards carry on while a snapshot is
+    // taken. Returns the count.
+    size_t save(CheckpointWriter &writer) const;
+    // Re-inserts members written by save() in the same mode; false if the
+    // section is malformed.
+    bool load(CheckpointCursor cursor, size_t count);
+};
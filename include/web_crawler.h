@@ -6,37 +6,98 @@
 #include <bits/stdc++.h>
 #include <atomic>
 #include <fstream>
-#include "thread_safe_queue.h"
 #include "page_metadata.h"
+#include "fetch_engine.h"
+#include "url_frontier.h"
+#include "work_stealing_deque.h"
+#include "visited_set.h"
+#include "crawler_options.h"
+#include "write_ahead_log.h"
+#include "query_rules.h"
+#include "trap_detector.h"
 #include <gumbo.h>
 
 #include "finalize_json.h" // Include the header for finalizeJsonFiles
+using LinkBatch = std::vector<std::pair<std::string, int>>;
+
 class WebCrawler
 {
 private:
-    ThreadSafeQueue<std::pair<std::string,int>> urlQueue;
-    std::unordered_set<std::string> visitedUrls;
-    std::mutex visitedMutex;
+    UrlFrontier urlQueue;
+    VisitedSet visitedUrls;
     std::vector<std::thread> workers;
     std::atomic<bool> shouldStop{false};
     int maxDepth;
     int numThreads;
     std::vector<std::ofstream> threadFiles;
     std::mutex filesMutex;
-    std::atomic<int> activeThreads{0};
-    std::unordered_map<std::string, std::chrono::steady_clock::time_point> domainLastRequest;
-    std::chrono::milliseconds domainDelay{1000};
+    // URLs accepted into the crawl that have not finished processing yet;
+    // the crawl is complete exactly when this drops to zero
+    std::atomic<long> pendingWork{0};
+    std::mutex doneMutex;
+    std::condition_variable doneCond;
     std::unordered_map<int, bool> threadFileContainsJson; 
-    static size_t WriteCallback(void* contents, size_t size, size_t nmemb, std::string* userp);
-    std::vector<std::string> extractLinks(const std::string& html, const std::string& baseUrl);
-    void extractLinksHelper(GumboNode* node, std::vector<std::string>& links, const std::string& baseUrl);
+    std::vector<std::unique_ptr<WorkStealingDeque<LinkBatch *>>> linkDeques;
+    MpmcRing<FetchResult> completedFetches{4096};
+    std::unique_ptr<CurlShare> curlShare;
+    std::vector<std::unique_ptr<FetchEngine>> fetchEngines;
+    std::chrono::steady_clock::time_point startTime;
+    // Link batches built by processResult that are not in the frontier yet;
+    // a snapshot reads them together with the frontier
+    std::mutex batchMutex;
+    std::unordered_set<LinkBatch *> liveBatches;
+    // Visited inserts whose batch is not published yet, split by snapshot
+    // epoch so a snapshot only waits for the ones that started before it
+    uint64_t claimEpoch = 0;
+    long openClaims[2] = {0, 0};
+    std::condition_variable claimsClosed;
+    std::string stateDir;
+    std::string checkpointPath;
+    std::chrono::seconds checkpointInterval;
+    std::chrono::milliseconds walCommitInterval;
+    std::unique_ptr<WriteAheadLog> wal;
+    std::unique_ptr<QueryRules> queryRules;
+    std::unique_ptr<TrapDetector> traps;
+    // Pages and links skipped because of robots meta, rel=nofollow or rel=canonical
+    std::atomic<size_t> noindexPages{0};
+    std::atomic<size_t> nofollowPages{0};
+    std::atomic<size_t> nofollowLinks{0};
+    std::atomic<size_t> canonicalPages{0};
+    std::atomic<size_t> domBytes{0};
+    std::atomic<size_t> domNanos{0};
+    std::atomic<size_t> scanBytes{0};
+    std::atomic<size_t> scanNanos{0};
+    std::atomic<size_t> comparedPages{0};
+    std::atomic<size_t> mismatchedPages{0};
+    std::atomic<size_t> redirectHops{0};       // redirect URLs this crawl claimed as visited
+    std::atomic<size_t> redirectDuplicates{0}; // redirected onto a URL that was already claimed
+    bool resume;
+    ExtractMode extractMode;
+    bool parseArena;
+    std::thread checkpointThread;
     PageMetadata extractMetadata(const std::string& html, const std::string& url, int depth);
     void processUrl(const std::string& url, int depth, int threadId);
+    void processResult(FetchResult& result, int threadId);
+    LinkBatch *claimRedirects(const FetchResult& result, std::string& pageUrl, std::vector<std::string>& redirectedFrom);
+    void retireHops(LinkBatch *hops);
+    int openClaim();
+    void closeClaim(int side, LinkBatch *batch);
+    bool takeLinks(int threadId, LinkBatch *&batch);
+    void finishWork(long count = 1);
+    void retire(const std::string& url);
     void workerThread(int threadId);
+    void reportStats();
+    void saveCheckpoint();
+    // Deletes the frontier segments snapshots linked into the state directory:
+    // those named with prefix when keep is false, all others when it is true
+    void removeSnapshotSegments(const std::string &prefix, bool keep);
+    bool resumeFromCheckpoint();
+    void checkpointLoop();
 
 
 public:
-    WebCrawler(int threads = 4, int depth = 3, int delayMs = 1000);
+    WebCrawler(int threads = 4, int depth = 3, int delayMs = 1000, int fetchThreads = 1, int maxInFlight = 1000);
+    explicit WebCrawler(const CrawlerOptions &options);
     ~WebCrawler();
     void start(const std::string& seedUrl);
     void stop();
@@ -0,0 +1,137 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli, PPoPP'13).
+// Only the owning thread may push and pop, at the bottom; any thread may
+// steal from the top. T must be trivially copyable, in practice a pointer.
+template <typename T>
+class WorkStealingDeque
+{
+private:
+    struct Buffer
+    {
+        int64_t capacity;
+        std::atomic<T> *slots;
+
+        explicit Buffer(int64_t cap) : capacity(cap), slots(new std::atomic<T>[cap]) {}
+        ~Buffer() { delete[] slots; }
+        T get(int64_t i) const { return slots[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(int64_t i, T value) { slots[i & (capacity - 1)].store(value, std::memory_order_relaxed); }
+    };
+
+    alignas(64) std::atomic<int64_t> top{0};
+    alignas(64) std::atomic<int64_t> bottom{0};
+    alignas(64) std::atomic<Buffer *> buffer;
+    // Retired buffers may still be read by a concurrent thief, so they live until destruction
+    std::vector<Buffer *> retired;
+
+public:
+    explicit WorkStealingDeque(int64_t capacity = 256);
+    ~WorkStealingDeque();
+    WorkStealingDeque(const WorkStealingDeque &) = delete;
+    WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+    void push(T value);
+    bool pop(T &value);
+    bool steal(T &value);
+    bool empty() const;
+};
+
+template <typename T>
+WorkStealingDeque<T>::WorkStealingDeque(int64_t capacity)
+{
+    int64_t cap = 1;
+    while (cap < capacity)
+        cap <<= 1;
+    buffer.store(new Buffer(cap), std::memory_order_relaxed);
+}
+
+template <typename T>
+WorkStealingDeque<T>::~WorkStealingDeque()
+{
+    delete buffer.load(std::memory_order_relaxed);
+    for (Buffer *old : retired)
+    {
+        delete old;
+    }
+}
+
+template <typename T>
+void WorkStealingDeque<T>::push(T value)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_acquire);
+    Buffer *buf = buffer.load(std::memory_order_relaxed);
+    if (b - t > buf->capacity - 1)
+    {
+        Buffer *bigger = new Buffer(buf->capacity * 2);
+        for (int64_t i = t; i < b; ++i)
+        {
+            bigger->put(i, buf->get(i));
+        }
+        retired.push_back(buf);
+        buffer.store(bigger, std::memory_order_release);
+        buf = bigger;
+    }
+    buf->put(b, value);
+    std::atomic_thread_fence(std::memory_order_release);
+    bottom.store(b + 1, std::memory_order_relaxed);
+}
+
+template <typename T>
+bool WorkStealingDeque<T>::pop(T &value)
+{
+    int64_t b = bottom.load(std::memory_order_relaxed) - 1;
+    Buffer *buf = buffer.load(std::memory_order_relaxed);
+    bottom.store(b, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t t = top.load(std::memory_order_relaxed);
+
+    if (t > b)
+    {
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return false;
+    }
+
+    value = buf->get(b);
+    if (t == b)
+    {
+        // Last element: race a concurrent thief for it
+        bool won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+        bottom.store(b + 1, std::memory_order_relaxed);
+        return won;
+    }
+    return true;
+}
+
+template <typename T>
+bool WorkStealingDeque<T>::steal(T &value)
+{
+    int64_t t = top.load(std::memory_order_acquire);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    int64_t b = bottom.load(std::memory_order_acquire);
+    if (t >= b)
+    {
+        return false;
+    }
+
+    Buffer *buf = buffer.load(std::memory_order_acquire);
+    T candidate = buf->get(t);
+    if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+    {
+        return false;
+    }
+    value = candidate;
+    return true;
+}
+
+template <typename T>
+bool WorkStealingDeque<T>::empty() const
+{
+    int64_t b = bottom.load(std::memory_order_relaxed);
+    int64_t t = top.load(std::memory_order_relaxed);
+    return b <= t;
+}
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <condition_variable>
+#include <cstdint>
+
+enum class WalRecord : uint8_t
+{
+    Discovered = 1, // URL entered the visited set and the frontier
+    Done = 2        // URL finished processing, successfully or not
+};
+
+struct WalStats
+{
+    size_t records = 0;
+    size_t commits = 0;
+    size_t bytes = 0;
+};
+
+// Append-only log of crawl state changes made since the last checkpoint.
+// Appends only copy into a shared buffer; a flusher thread writes and
+// fdatasyncs the buffer every commit interval, so all records from that
+// window share one sync (group commit) and a crash loses at most one
+// interval. The log is split into numbered segments: a checkpoint rotates
+// to a fresh segment before it starts and drops the older ones once it is
+// on disk. Throws std::runtime_error if a segment cannot be created.
+//
+// A failed write or sync could leave a torn record mid-segment, and replay
+// stops at the first bad record, so after any I/O error the log fails for
+// good: later appends are dropped, rotate() throws, and onFailure is called
+// once from the flusher thread.
+class WriteAheadLog
+{
+private:
+    std::string directory;
+    std::chrono::milliseconds commitInterval;
+    int fd;
+    uint64_t sequence;
+    std::mutex mutex;      // guards buffer
+    std::mutex fileMutex;  // guards fd; taken before mutex is released so writes keep append order
+    std::string buffer;
+    std::condition_variable flushCond;
+    bool stopping = false;
+    std::thread flusher;
+    std::atomic<size_t> records{0};
+    std::atomic<size_t> commits{0};
+    std::atomic<size_t> bytes{0};
+    std::atomic<bool> broken{false};
+    std::function<void(const std::string &)> onFailure;
+
+    void openSegment(uint64_t seq);
+    void encode(WalRecord type, const std::string &url, int depth);
+    void flush(std::unique_lock<std::mutex> &lock);
+    void run();
+
+public:
+    WriteAheadLog(const std::string &dir, std::chrono::milliseconds interval,
+                  std::function<void(const std::string &)> failed = nullptr);
+    ~WriteAheadLog();
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    void append(WalRecord type, const std::string &url, int depth = 0);
+    void appendBatch(WalRecord type, const std::vector<std::pair<std::string, int>> &items);
+    // Flushes the current segment and continues in a new one; returns its number
+    uint64_t rotate();
+    void removeBefore(uint64_t seq);
+    WalStats stats() const;
+    bool failed() const { return broken; }
+
+    // Segment paths in dir, oldest first
+    static std::vector<std::string> segments(const std::string &dir);
+    // Applies every intact record of one segment in order and stops at a torn
+    // or corrupt tail. Returns the number of records applied.
+    static size_t replay(const std::string &path, const std::function<void(WalRecord, const std::string &, int)> &apply);
+};
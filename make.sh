@@ -2,6 +2,23 @@
 mkdir -p bin
 mkdir -p obj
 g++ -I./include -Wall -Wextra -std=c++17 -c src/main.cpp -o obj/main.o
-g++ -I./include -Wall -Wextra -std=c++17 -c src/utils.cpp -o obj/utils.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/url_view.cpp -o obj/url_view.o
 g++ -I./include -Wall -Wextra -std=c++17 -c src/web_crawler.cpp -o obj/web_crawler.o
-g++ obj/main.o obj/utils.o obj/web_crawler.o -o bin/web_crawler -lcurl -lgumbo -pthread
\ No newline at end of file
+g++ -I./include -Wall -Wextra -std=c++17 -c src/fetch_engine.cpp -o obj/fetch_engine.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/curl_share.cpp -o obj/curl_share.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/url_frontier.cpp -o obj/url_frontier.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/visited_set.cpp -o obj/visited_set.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/fingerprint.cpp -o obj/fingerprint.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/bloom_filter.cpp -o obj/bloom_filter.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/disk_fingerprint_store.cpp -o obj/disk_fingerprint_store.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/spill_queue.cpp -o obj/spill_queue.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/checkpoint.cpp -o obj/checkpoint.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/write_ahead_log.cpp -o obj/write_ahead_log.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/url_normalizer.cpp -o obj/url_normalizer.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/query_rules.cpp -o obj/query_rules.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/trap_detector.cpp -o obj/trap_detector.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/dom_visitor.cpp -o obj/dom_visitor.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/page_extractors.cpp -o obj/page_extractors.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/link_scanner.cpp -o obj/link_scanner.o
+g++ -I./include -Wall -Wextra -std=c++17 -c src/parse_arena.cpp -o obj/parse_arena.o
+g++ obj/main.o obj/url_view.o obj/web_crawler.o obj/fetch_engine.o obj/curl_share.o obj/url_frontier.o obj/visited_set.o obj/fingerprint.o obj/bloom_filter.o obj/disk_fingerprint_store.o obj/spill_queue.o obj/checkpoint.o obj/write_ahead_log.o obj/url_normalizer.o obj/query_rules.o obj/trap_detector.o obj/dom_visitor.o obj/page_extractors.o obj/link_scanner.o obj/parse_arena.o -o bin/web_crawler -lcurl -lgumbo -pthread
\ No newline at end of file
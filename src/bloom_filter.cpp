@@ -0,0 +1,49 @@
+#include "bloom_filter.h"
+#include <algorithm>
+#include <cmath>
+
+static const size_t kBlockBits = 512;
+static const size_t kBlockWords = kBlockBits / 64;
+
+BlockedBloomFilter::BlockedBloomFilter(size_t expectedItems, double falsePositiveRate)
+{
+    double n = static_cast<double>(std::max<size_t>(expectedItems, 1));
+    double p = std::min(std::max(falsePositiveRate, 1e-9), 0.5);
+    double ln2 = std::log(2.0);
+    // Classic optimum m = -n ln p / (ln 2)^2; blocking costs a little accuracy,
+    // so round up generously rather than down
+    double bits = -n * std::log(p) / (ln2 * ln2);
+    blockCount = std::max<size_t>(1, static_cast<size_t>(std::ceil(bits / kBlockBits)));
+    hashCount = std::min(16, std::max(1, static_cast<int>(std::round(bits / n * ln2))));
+    words.assign(blockCount * kBlockWords, 0);
+}
+
+bool BlockedBloomFilter::testAndSet(const Fingerprint128 &key)
+{
+    uint64_t *block = &words[static_cast<size_t>((static_cast<unsigned __int128>(key.hi) * blockCount) >> 64) * kBlockWords];
+    uint32_t h1 = static_cast<uint32_t>(key.lo);
+    uint32_t h2 = static_cast<uint32_t>(key.lo >> 32) | 1;
+    bool present = true;
+    for (int i = 0; i < hashCount; ++i)
+    {
+        uint32_t bit = (h1 + i * h2) & (kBlockBits - 1);
+        uint64_t mask = uint64_t(1) << (bit & 63);
+        present = present && (block[bit >> 6] & mask);
+        block[bit >> 6] |= mask;
+    }
+    return present;
+}
+
+bool BlockedBloomFilter::mayContain(const Fingerprint128 &key) const
+{
+    const uint64_t *block = &words[static_cast<size_t>((static_cast<unsigned __int128>(key.hi) * blockCount) >> 64) * kBlockWords];
+    uint32_t h1 = static_cast<uint32_t>(key.lo);
+    uint32_t h2 = static_cast<uint32_t>(key.lo >> 32) | 1;
+    for (int i = 0; i < hashCount; ++i)
+    {
+        uint32_t bit = (h1 + i * h2) & (kBlockBits - 1);
+        if (!(block[bit >> 6] & (uint64_t(1) << (bit & 63))))
+            return false;
+    }
+    return true;
+}
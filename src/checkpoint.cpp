@@ -0,0 +1,212 @@
+#include "checkpoint.h"
+#include <cstdio>
+#include <cstring>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static const char kMagic[8] = {'C', 'R', 'W', 'L', 'C', 'K', 'P', 'T'};
+static const uint32_t kVersion = 3;
+static const size_t kSections = 4;
+static const size_t kWriteBytes = 1 << 20;
+
+struct CheckpointHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t visitedMode;
+    uint64_t counts[kSections];
+    uint64_t sizes[kSections];
+};
+
+void appendU32(std::string &out, uint32_t value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void appendU64(std::string &out, uint64_t value)
+{
+    out.append(reinterpret_cast<const char *>(&value), sizeof(value));
+}
+
+void appendBytes(std::string &out, const std::string &value)
+{
+    appendU32(out, static_cast<uint32_t>(value.size()));
+    out.append(value);
+}
+
+bool CheckpointCursor::getU32(uint32_t &value)
+{
+    if (static_cast<size_t>(end - pos) < sizeof(value))
+        return false;
+    std::memcpy(&value, pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+bool CheckpointCursor::getU64(uint64_t &value)
+{
+    if (static_cast<size_t>(end - pos) < sizeof(value))
+        return false;
+    std::memcpy(&value, pos, sizeof(value));
+    pos += sizeof(value);
+    return true;
+}
+
+bool CheckpointCursor::getBytes(std::string &value)
+{
+    uint32_t size;
+    if (!getU32(size) || static_cast<size_t>(end - pos) < size)
+        return false;
+    value.assign(pos, size);
+    pos += size;
+    return true;
+}
+
+static void writeAll(int fd, const char *data, size_t size, const std::string &path)
+{
+    while (size > 0)
+    {
+        ssize_t written = write(fd, data, size);
+        if (written < 0)
+        {
+            throw std::runtime_error("Cannot write checkpoint " + path);
+        }
+        data += written;
+        size -= static_cast<size_t>(written);
+    }
+}
+
+CheckpointWriter::CheckpointWriter(const std::string &checkpointPath, uint32_t visitedMode)
+    : path(checkpointPath), temp(checkpointPath + ".tmp"), mode(visitedMode)
+{
+    fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot create checkpoint " + temp);
+    }
+    // The header is written last, once the section sizes are known
+    if (lseek(fd, sizeof(CheckpointHeader), SEEK_SET) < 0)
+    {
+        close(fd);
+        throw std::runtime_error("Cannot write checkpoint " + temp);
+    }
+    buffer.reserve(kWriteBytes + 4096);
+}
+
+CheckpointWriter::~CheckpointWriter()
+{
+    close(fd);
+    if (!committed)
+        std::remove(temp.c_str());
+}
+
+void CheckpointWriter::writeBuffer()
+{
+    writeAll(fd, buffer.data(), buffer.size(), temp);
+    sizes[section] += buffer.size();
+    buffer.clear();
+}
+
+void CheckpointWriter::endRecord()
+{
+    counts[section]++;
+    if (buffer.size() >= kWriteBytes)
+        writeBuffer();
+}
+
+void CheckpointWriter::endSection()
+{
+    writeBuffer();
+    section++;
+}
+
+void CheckpointWriter::commit()
+{
+    while (section < kSections)
+        endSection();
+
+    CheckpointHeader header{};
+    std::memcpy(header.magic, kMagic, sizeof(kMagic));
+    header.version = kVersion;
+    header.visitedMode = mode;
+    for (size_t i = 0; i < kSections; ++i)
+    {
+        header.counts[i] = counts[i];
+        header.sizes[i] = sizes[i];
+    }
+    if (pwrite(fd, &header, sizeof(header), 0) != static_cast<ssize_t>(sizeof(header)))
+    {
+        throw std::runtime_error("Cannot write checkpoint " + temp);
+    }
+    if (fsync(fd) != 0)
+    {
+        throw std::runtime_error("Cannot sync checkpoint " + temp);
+    }
+    if (std::rename(temp.c_str(), path.c_str()) != 0)
+    {
+        throw std::runtime_error("Cannot replace checkpoint " + path);
+    }
+    committed = true;
+}
+
+CheckpointFile::CheckpointFile(const std::string &path)
+    : data(nullptr), length(0), mode(0)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open checkpoint " + path);
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || static_cast<size_t>(st.st_size) < sizeof(CheckpointHeader))
+    {
+        close(fd);
+        throw std::runtime_error("Checkpoint " + path + " is truncated");
+    }
+    length = static_cast<size_t>(st.st_size);
+    void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        throw std::runtime_error("Cannot map checkpoint " + path);
+    }
+    data = static_cast<const char *>(addr);
+    // Sections are decoded front to back exactly once
+    madvise(addr, length, MADV_SEQUENTIAL);
+
+    CheckpointHeader header;
+    std::memcpy(&header, data, sizeof(header));
+    if (std::memcmp(header.magic, kMagic, sizeof(kMagic)) != 0 || header.version != kVersion)
+    {
+        munmap(addr, length);
+        throw std::runtime_error(path + " is not a crawler checkpoint");
+    }
+
+    mode = header.visitedMode;
+    size_t offset = sizeof(header);
+    for (size_t i = 0; i < kSections; ++i)
+    {
+        if (header.sizes[i] > length - offset)
+        {
+            munmap(addr, length);
+            throw std::runtime_error("Checkpoint " + path + " is truncated");
+        }
+        counts[i] = header.counts[i];
+        sectionStart[i] = data + offset;
+        sectionSize[i] = header.sizes[i];
+        offset += header.sizes[i];
+    }
+}
+
+CheckpointFile::~CheckpointFile()
+{
+    munmap(const_cast<char *>(data), length);
+}
+
+CheckpointCursor CheckpointFile::cursor(Section section) const
+{
+    return CheckpointCursor{sectionStart[section], sectionStart[section] + sectionSize[section]};
+}
@@ -0,0 +1,72 @@
+#include "curl_share.h"
+
+void CurlShare::lockCallback(CURL *, curl_lock_data data, curl_lock_access, void *userp)
+{
+    static_cast<CurlShare *>(userp)->locks[data].lock();
+}
+
+void CurlShare::unlockCallback(CURL *, curl_lock_data data, void *userp)
+{
+    static_cast<CurlShare *>(userp)->locks[data].unlock();
+}
+
+CurlShare::CurlShare()
+{
+    share = curl_share_init();
+    curl_share_setopt(share, CURLSHOPT_LOCKFUNC, lockCallback);
+    curl_share_setopt(share, CURLSHOPT_UNLOCKFUNC, unlockCallback);
+    curl_share_setopt(share, CURLSHOPT_USERDATA, this);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+    curl_share_setopt(share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+}
+
+CurlShare::~CurlShare()
+{
+    curl_share_cleanup(share);
+}
+
+CURLSH *CurlShare::handle() const
+{
+    return share;
+}
+
+void CurlShare::recordTransfer(CURL *easy)
+{
+    long connects = 0;
+    curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &connects);
+    if (connects == 0)
+        return; // Reused a cached connection, no lookup or handshake happened
+
+    curl_off_t lookup = 0;
+    curl_off_t connected = 0;
+    curl_off_t appConnected = 0;
+    curl_easy_getinfo(easy, CURLINFO_NAMELOOKUP_TIME_T, &lookup);
+    curl_easy_getinfo(easy, CURLINFO_CONNECT_TIME_T, &connected);
+    curl_easy_getinfo(easy, CURLINFO_APPCONNECT_TIME_T, &appConnected);
+    if (lookup < kDnsHitMicros)
+    {
+        dnsHits++;
+    }
+    else
+    {
+        dnsMisses++;
+        dnsMicros += lookup;
+    }
+    // Zero for plain HTTP; TLS finishes after the TCP connect
+    if (appConnected > connected)
+    {
+        tlsHandshakes++;
+        tlsMicros += appConnected - connected;
+    }
+}
+
+ShareStats CurlShare::stats() const
+{
+    ShareStats s;
+    s.dnsHits = dnsHits;
+    s.dnsMisses = dnsMisses;
+    s.dnsMicros = dnsMicros;
+    s.tlsHandshakes = tlsHandshakes;
+    s.tlsMicros = tlsMicros;
+    return s;
+}
@@ -0,0 +1,254 @@
+#include "disk_fingerprint_store.h"
+#include <algorithm>
+#include <cstdio>
+#include <filesystem>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+static bool keyLess(const Fingerprint128 &a, const Fingerprint128 &b)
+{
+    return a.lo != b.lo ? a.lo < b.lo : a.hi < b.hi;
+}
+
+// FingerprintTable stores the all-zero key as lo = 1; runs use the same spelling
+static Fingerprint128 normalized(Fingerprint128 key)
+{
+    key.lo += (key.lo == 0 && key.hi == 0);
+    return key;
+}
+
+static void writeAll(int fd, const void *data, size_t bytes, const std::string &path)
+{
+    const char *p = static_cast<const char *>(data);
+    while (bytes > 0)
+    {
+        ssize_t n = write(fd, p, bytes);
+        if (n <= 0)
+            throw std::runtime_error("Cannot write visited run " + path);
+        p += n;
+        bytes -= static_cast<size_t>(n);
+    }
+}
+
+DiskFingerprintStore::Run::~Run()
+{
+    if (keys)
+        munmap(const_cast<Fingerprint128 *>(keys), count * sizeof(Fingerprint128));
+    if (fd >= 0)
+        close(fd);
+    std::remove(path.c_str());
+}
+
+bool DiskFingerprintStore::Run::contains(const Fingerprint128 &key) const
+{
+    // The fences pick the one page that can hold the key
+    auto fence = std::upper_bound(fences.begin(), fences.end(), key, keyLess);
+    if (fence == fences.begin())
+        return false;
+    size_t begin = static_cast<size_t>(fence - fences.begin() - 1) * kKeysPerPage;
+    size_t end = std::min(count, begin + kKeysPerPage);
+    const Fingerprint128 *found = std::lower_bound(keys + begin, keys + end, key, keyLess);
+    return found != keys + end && *found == key;
+}
+
+DiskFingerprintStore::DiskFingerprintStore(const std::string &pathPrefix)
+    : prefix(pathPrefix)
+{
+    // Runs left by an earlier process describe a crawl that is not this one
+    namespace fs = std::filesystem;
+    fs::path base(prefix);
+    fs::path dir = base.has_parent_path() ? base.parent_path() : fs::path(".");
+    std::string stem = base.filename().string() + "_";
+    for (const auto &entry : fs::directory_iterator(dir))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.rfind(stem, 0) == 0 && entry.path().extension() == ".run")
+            fs::remove(entry.path());
+    }
+}
+
+std::unique_ptr<DiskFingerprintStore::Run> DiskFingerprintStore::mapRun(const std::string &path, int fd,
+                                                                        size_t count)
+{
+    auto run = std::make_unique<Run>();
+    run->path = path;
+    run->fd = fd;
+    run->count = count;
+    void *addr = mmap(nullptr, count * sizeof(Fingerprint128), PROT_READ, MAP_SHARED, fd, 0);
+    if (addr == MAP_FAILED)
+        throw std::runtime_error("Cannot map visited run " + path);
+    run->keys = static_cast<const Fingerprint128 *>(addr);
+    // Lookups land on one page each, so readahead would only pull in pages nobody asked for
+    madvise(addr, count * sizeof(Fingerprint128), MADV_RANDOM);
+    run->fences.reserve(count / kKeysPerPage + 1);
+    for (size_t i = 0; i < count; i += kKeysPerPage)
+    {
+        run->fences.push_back(run->keys[i]);
+    }
+    return run;
+}
+
+std::unique_ptr<DiskFingerprintStore::Run> DiskFingerprintStore::writeRun(const std::vector<Fingerprint128> &keys)
+{
+    std::string path = prefix + "_" + std::to_string(nextRun++) + ".run";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open visited run " + path);
+    writeAll(fd, keys.data(), keys.size() * sizeof(Fingerprint128), path);
+    return mapRun(path, fd, keys.size());
+}
+
+std::unique_ptr<DiskFingerprintStore::Run> DiskFingerprintStore::mergeRuns(const Run &older, const Run &newer)
+{
+    std::string path = prefix + "_" + std::to_string(nextRun++) + ".run";
+    int fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (fd < 0)
+        throw std::runtime_error("Cannot open visited run " + path);
+    madvise(const_cast<Fingerprint128 *>(older.keys), older.count * sizeof(Fingerprint128), MADV_SEQUENTIAL);
+    madvise(const_cast<Fingerprint128 *>(newer.keys), newer.count * sizeof(Fingerprint128), MADV_SEQUENTIAL);
+
+    // Both inputs are sorted and disjoint, so this is one streaming pass over each
+    std::vector<Fingerprint128> buffer;
+    buffer.reserve(1 << 16);
+    size_t i = 0;
+    size_t j = 0;
+    while (i < older.count || j < newer.count)
+    {
+        if (j == newer.count || (i < older.count && keyLess(older.keys[i], newer.keys[j])))
+            buffer.push_back(older.keys[i++]);
+        else
+            buffer.push_back(newer.keys[j++]);
+        if (buffer.size() == buffer.capacity())
+        {
+            writeAll(fd, buffer.data(), buffer.size() * sizeof(Fingerprint128), path);
+            buffer.clear();
+        }
+    }
+    writeAll(fd, buffer.data(), buffer.size() * sizeof(Fingerprint128), path);
+    return mapRun(path, fd, older.count + newer.count);
+}
+
+bool DiskFingerprintStore::containsLocked(const Fingerprint128 &key) const
+{
+    if (recent.contains(key))
+        return true;
+    std::shared_lock<std::shared_mutex> lock(runsMutex);
+    if (flushing.contains(key))
+        return true;
+    Fingerprint128 stored = normalized(key);
+    // Newest first: recent keys are the likeliest repeats, and their runs are small and cached
+    for (auto run = runs.rbegin(); run != runs.rend(); ++run)
+    {
+        if ((*run)->contains(stored))
+            return true;
+    }
+    return false;
+}
+
+bool DiskFingerprintStore::insert(Fingerprint128 key)
+{
+    std::lock_guard<std::mutex> lock(recentMutex);
+    if (containsLocked(key))
+        return false;
+    recent.insert(key);
+    return true;
+}
+
+void DiskFingerprintStore::add(Fingerprint128 key)
+{
+    std::lock_guard<std::mutex> lock(recentMutex);
+    recent.insert(key);
+}
+
+bool DiskFingerprintStore::contains(Fingerprint128 key) const
+{
+    std::lock_guard<std::mutex> lock(recentMutex);
+    return containsLocked(key);
+}
+
+bool DiskFingerprintStore::flushDue() const
+{
+    std::lock_guard<std::mutex> lock(recentMutex);
+    return recent.size() >= kBufferKeys;
+}
+
+void DiskFingerprintStore::flush()
+{
+    std::unique_lock<std::mutex> flusher(flushMutex, std::try_to_lock);
+    if (!flusher.owns_lock())
+        return; // Another thread is flushing; this buffer goes out with the next one
+
+    {
+        std::lock_guard<std::mutex> lock(recentMutex);
+        if (recent.size() < kBufferKeys)
+            return;
+        std::unique_lock<std::shared_mutex> runsLock(runsMutex);
+        flushing = std::move(recent);
+        recent = FingerprintTable<Fingerprint128>(16);
+    }
+
+    // Only the flusher changes flushing and runs, so it reads them without the lock
+    std::vector<Fingerprint128> keys;
+    keys.reserve(flushing.size());
+    flushing.forEach([&keys](const Fingerprint128 &key) { keys.push_back(key); });
+    std::sort(keys.begin(), keys.end(), keyLess);
+    std::unique_ptr<Run> run = writeRun(keys);
+    {
+        std::unique_lock<std::shared_mutex> runsLock(runsMutex);
+        runs.push_back(std::move(run));
+        flushing = FingerprintTable<Fingerprint128>(16);
+    }
+
+    // Merge while the newest run is as big as its older neighbour, like carries in
+    // a binary counter: run sizes stay geometric and their number logarithmic
+    while (runs.size() >= 2 && runs[runs.size() - 1]->count >= runs[runs.size() - 2]->count)
+    {
+        std::unique_ptr<Run> merged = mergeRuns(*runs[runs.size() - 2], *runs.back());
+        std::unique_ptr<Run> older;
+        std::unique_ptr<Run> newer;
+        {
+            std::unique_lock<std::shared_mutex> runsLock(runsMutex);
+            newer = std::move(runs.back());
+            runs.pop_back();
+            older = std::move(runs.back());
+            runs.back() = std::move(merged);
+        }
+    }
+}
+
+size_t DiskFingerprintStore::size() const
+{
+    std::lock_guard<std::mutex> lock(recentMutex);
+    std::shared_lock<std::shared_mutex> runsLock(runsMutex);
+    size_t total = recent.size() + flushing.size();
+    for (const auto &run : runs)
+    {
+        total += run->count;
+    }
+    return total;
+}
+
+size_t DiskFingerprintStore::diskBytes() const
+{
+    std::shared_lock<std::shared_mutex> lock(runsMutex);
+    size_t total = 0;
+    for (const auto &run : runs)
+    {
+        total += run->count * sizeof(Fingerprint128);
+    }
+    return total;
+}
+
+size_t DiskFingerprintStore::memoryBytes() const
+{
+    std::lock_guard<std::mutex> lock(recentMutex);
+    std::shared_lock<std::shared_mutex> runsLock(runsMutex);
+    size_t total = recent.memoryBytes() + flushing.memoryBytes();
+    for (const auto &run : runs)
+    {
+        total += run->fences.capacity() * sizeof(Fingerprint128);
+    }
+    return total;
+}
@@ -0,0 +1,31 @@
+#include "dom_visitor.h"
+
+void walkDom(const GumboNode *root, const std::vector<DomVisitor *> &visitors)
+{
+    // Explicit stack: deeply nested pages must not exhaust the thread's stack
+    thread_local std::vector<const GumboNode *> stack;
+    stack.clear();
+    stack.push_back(root);
+    while (!stack.empty())
+    {
+        const GumboNode *node = stack.back();
+        stack.pop_back();
+        if (node->type != GUMBO_NODE_ELEMENT && node->type != GUMBO_NODE_TEMPLATE)
+            continue;
+
+        const GumboElement &element = node->v.element;
+        for (DomVisitor *visitor : visitors)
+        {
+            visitor->visit(element);
+        }
+        for (unsigned int i = element.children.length; i > 0; --i)
+        {
+            stack.push_back(static_cast<const GumboNode *>(element.children.data[i - 1]));
+        }
+    }
+
+    for (DomVisitor *visitor : visitors)
+    {
+        visitor->finish();
+    }
+}
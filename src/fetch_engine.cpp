@@ -0,0 +1,459 @@
+#include "fetch_engine.h"
+#include "url_normalizer.h"
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#include <strings.h>
+
+size_t FetchEngine::WriteCallback(void *contents, size_t size, size_t nmemb, void *userp)
+{
+    Transfer *transfer = static_cast<Transfer *>(userp);
+    size_t length = size * nmemb;
+    FetchEngine *engine = transfer->engine;
+    if (!engine->scanBodies)
+    {
+        transfer->body.append(static_cast<char *>(contents), length);
+        return length;
+    }
+
+    // Parse while the rest of the body is still in flight. Only redirected-to
+    // bodies reach here, so the effective URL is the page's own.
+    auto start = std::chrono::steady_clock::now();
+    if (!transfer->scanner && engine->bodyBytesAfterHead > 0)
+    {
+        // Nothing to learn from images, archives and the like in head-only mode
+        char *type = nullptr;
+        curl_easy_getinfo(transfer->easy, CURLINFO_CONTENT_TYPE, &type);
+        if (type && strncasecmp(type, "text/html", 9) != 0 && strncasecmp(type, "application/xhtml", 17) != 0)
+        {
+            transfer->stoppedEarly = true;
+            transfer->notHtml = true;
+            engine->skippedNonHtml++;
+            return 0;
+        }
+    }
+    if (!transfer->scanner)
+    {
+        char *effective = nullptr;
+        curl_easy_getinfo(transfer->easy, CURLINFO_EFFECTIVE_URL, &effective);
+        transfer->metadata.url = normalizeUrl(effective ? effective : transfer->request.url);
+        if (transfer->metadata.url.empty())
+            transfer->metadata.url = transfer->request.url;
+        transfer->scanner = std::make_unique<LinkScanner>(transfer->metadata);
+    }
+    transfer->scanner->feed(static_cast<char *>(contents), length);
+    transfer->received += length;
+    engine->scannedBytes += length;
+    engine->scanNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+
+    // Returning short makes curl abort the transfer with CURLE_WRITE_ERROR
+    size_t headEnd = transfer->scanner->headEnd();
+    if (engine->bodyBytesAfterHead > 0 && headEnd != std::string::npos &&
+        transfer->received - headEnd >= engine->bodyBytesAfterHead)
+    {
+        transfer->stoppedEarly = true;
+        return 0;
+    }
+    return length;
+}
+
+size_t FetchEngine::HeaderCallback(char *buffer, size_t size, size_t nitems, void *userp)
+{
+    // curl hands over the headers of every response in a redirect chain; keep
+    // the Location of each 3xx so the crawler can see the hops it followed
+    Transfer *transfer = static_cast<Transfer *>(userp);
+    size_t length = size * nitems;
+    if (length > 9 && strncmp(buffer, "HTTP/", 5) == 0)
+    {
+        const char *code = static_cast<const char *>(memchr(buffer, ' ', length));
+        transfer->redirecting = code && code + 1 < buffer + length && code[1] == '3';
+    }
+    else if (transfer->redirecting && length > 9 && strncasecmp(buffer, "location:", 9) == 0)
+    {
+        size_t begin = 9;
+        size_t end = length;
+        while (begin < end && (buffer[begin] == ' ' || buffer[begin] == '\t'))
+            begin++;
+        while (end > begin && (buffer[end - 1] == '\r' || buffer[end - 1] == '\n' || buffer[end - 1] == ' '))
+            end--;
+        transfer->redirects.emplace_back(buffer + begin, end - begin);
+    }
+    return length;
+}
+
+int FetchEngine::socketCallback(CURL *, curl_socket_t fd, int what, void *userp, void *)
+{
+    FetchEngine *engine = static_cast<FetchEngine *>(userp);
+    if (what == CURL_POLL_REMOVE)
+    {
+        epoll_ctl(engine->epollFd, EPOLL_CTL_DEL, fd, nullptr);
+        return 0;
+    }
+
+    epoll_event ev{};
+    ev.data.fd = fd;
+    if (what & CURL_POLL_IN)
+        ev.events |= EPOLLIN;
+    if (what & CURL_POLL_OUT)
+        ev.events |= EPOLLOUT;
+
+    if (epoll_ctl(engine->epollFd, EPOLL_CTL_MOD, fd, &ev) != 0 && errno == ENOENT)
+    {
+        epoll_ctl(engine->epollFd, EPOLL_CTL_ADD, fd, &ev);
+    }
+    return 0;
+}
+
+int FetchEngine::timerCallback(CURLM *, long timeoutMs, void *userp)
+{
+    FetchEngine *engine = static_cast<FetchEngine *>(userp);
+    itimerspec spec{};
+    if (timeoutMs >= 0)
+    {
+        // A zero it_value disarms the timer, so "now" is expressed as 1ns
+        spec.it_value.tv_sec = timeoutMs / 1000;
+        spec.it_value.tv_nsec = (timeoutMs % 1000) * 1000000 + 1;
+    }
+    timerfd_settime(engine->timerFd, 0, &spec, nullptr);
+    return 0;
+}
+
+FetchEngine::FetchEngine(MpmcRing<FetchResult> &completedQueue, CurlShare *curlShare, size_t maxTransfers,
+                         bool scanWhileReceiving, size_t headOnlyBytes)
+    : completed(completedQueue), share(curlShare), maxInFlight(maxTransfers),
+      scanBodies(scanWhileReceiving || headOnlyBytes > 0), bodyBytesAfterHead(headOnlyBytes)
+{
+    multi = curl_multi_init();
+    epollFd = epoll_create1(EPOLL_CLOEXEC);
+    timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    epoll_event ev{};
+    ev.events = EPOLLIN;
+    ev.data.fd = timerFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, timerFd, &ev);
+    ev.data.fd = wakeFd;
+    epoll_ctl(epollFd, EPOLL_CTL_ADD, wakeFd, &ev);
+
+    curl_multi_setopt(multi, CURLMOPT_SOCKETFUNCTION, socketCallback);
+    curl_multi_setopt(multi, CURLMOPT_SOCKETDATA, this);
+    curl_multi_setopt(multi, CURLMOPT_TIMERFUNCTION, timerCallback);
+    curl_multi_setopt(multi, CURLMOPT_TIMERDATA, this);
+    // Keep enough idle connections around that every in-flight host can be revisited warm
+    curl_multi_setopt(multi, CURLMOPT_MAXCONNECTS, static_cast<long>(maxInFlight));
+}
+
+FetchEngine::~FetchEngine()
+{
+    stop();
+    for (CURL *curl : idleHandles)
+    {
+        curl_easy_cleanup(curl);
+    }
+    curl_multi_cleanup(multi);
+    close(wakeFd);
+    close(timerFd);
+    close(epollFd);
+}
+
+void FetchEngine::start()
+{
+    loopThread = std::thread(&FetchEngine::run, this);
+}
+
+void FetchEngine::stop()
+{
+    stopping = true;
+    uint64_t one = 1;
+    (void)!write(wakeFd, &one, sizeof(one));
+    if (loopThread.joinable())
+    {
+        loopThread.join();
+    }
+}
+
+void FetchEngine::submit(FetchRequest request)
+{
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        pending.push_back(std::move(request));
+    }
+    uint64_t one = 1;
+    (void)!write(wakeFd, &one, sizeof(one));
+}
+
+bool FetchEngine::idle()
+{
+    std::lock_guard<std::mutex> lock(pendingMutex);
+    return pending.empty() && inFlight == 0;
+}
+
+FetchStats FetchEngine::stats() const
+{
+    FetchStats s;
+    s.completed = completedCount;
+    s.handlesCreated = handlesCreated;
+    s.connectionsOpened = connectionsOpened;
+    s.connectionsReused = connectionsReused;
+    s.scannedBytes = scannedBytes;
+    s.scanNanos = scanNanos;
+    s.stoppedEarly = stoppedEarly;
+    s.skippedNonHtml = skippedNonHtml;
+    s.bytesSaved = bytesSaved;
+    s.savedPages = savedPages;
+    return s;
+}
+
+CURL *FetchEngine::acquireHandle()
+{
+    if (!idleHandles.empty())
+    {
+        CURL *curl = idleHandles.back();
+        idleHandles.pop_back();
+        return curl;
+    }
+
+    // Options that never change between URLs are set once per handle
+    CURL *curl = curl_easy_init();
+    if (!curl)
+        return nullptr;
+    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, HeaderCallback);
+    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(curl, CURLOPT_MAXREDIRS, 10L);
+    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
+    curl_easy_setopt(curl, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(curl, CURLOPT_TCP_KEEPALIVE, 1L);
+    if (share)
+        curl_easy_setopt(curl, CURLOPT_SHARE, share->handle());
+    handlesCreated++;
+    return curl;
+}
+
+void FetchEngine::releaseHandle(CURL *curl)
+{
+    curl_multi_remove_handle(multi, curl);
+    idleHandles.push_back(curl);
+}
+
+void FetchEngine::addPending()
+{
+    std::vector<FetchRequest> batch;
+    {
+        std::lock_guard<std::mutex> lock(pendingMutex);
+        size_t room = maxInFlight > inFlight ? maxInFlight - inFlight : 0;
+        if (room == 0 || pending.empty())
+            return;
+        size_t take = std::min(room, pending.size());
+        batch.assign(std::make_move_iterator(pending.begin()), std::make_move_iterator(pending.begin() + take));
+        pending.erase(pending.begin(), pending.begin() + take);
+        // Count while still holding the lock so idle() never sees a gap
+        inFlight += take;
+    }
+
+    for (auto &request : batch)
+    {
+        CURL *curl = acquireHandle();
+        if (!curl)
+        {
+            fail(std::move(request), CURLE_FAILED_INIT);
+            continue;
+        }
+        Transfer *transfer = new Transfer();
+        transfer->easy = curl;
+        transfer->request = std::move(request);
+        transfer->engine = this;
+        curl_easy_setopt(curl, CURLOPT_URL, transfer->request.url.c_str());
+        curl_easy_setopt(curl, CURLOPT_WRITEDATA, transfer);
+        curl_easy_setopt(curl, CURLOPT_HEADERDATA, transfer);
+        curl_easy_setopt(curl, CURLOPT_PRIVATE, transfer);
+        if (curl_multi_add_handle(multi, curl) != CURLM_OK)
+        {
+            curl_easy_cleanup(curl);
+            fail(std::move(transfer->request), CURLE_FAILED_INIT);
+            delete transfer;
+            continue;
+        }
+        active.insert(transfer);
+    }
+}
+
+void FetchEngine::fail(FetchRequest request, CURLcode status)
+{
+    // Never started, but the crawler still has to hear about it or the URL stays pending forever
+    FetchResult result;
+    result.url = std::move(request.url);
+    result.depth = request.depth;
+    result.status = status;
+    result.httpCode = 0;
+    completedCount++;
+    if (!overflow.empty() || !completed.push(std::move(result)))
+    {
+        overflow.push_back(std::move(result));
+        return;
+    }
+    inFlight--;
+}
+
+void FetchEngine::drainCompleted()
+{
+    int remaining = 0;
+    while (CURLMsg *msg = curl_multi_info_read(multi, &remaining))
+    {
+        if (msg->msg != CURLMSG_DONE)
+            continue;
+
+        CURL *curl = msg->easy_handle;
+        Transfer *transfer = nullptr;
+        curl_easy_getinfo(curl, CURLINFO_PRIVATE, &transfer);
+
+        FetchResult result;
+        result.url = std::move(transfer->request.url);
+        result.depth = transfer->request.depth;
+        result.body = std::move(transfer->body);
+        result.status = msg->data.result;
+        result.httpCode = 0;
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &result.httpCode);
+        if (transfer->stoppedEarly && result.status == CURLE_WRITE_ERROR)
+        {
+            // Stopped on purpose in head-only mode: an HTML page is complete as far
+            // as the crawl cares, anything else keeps its error and is not a page
+            if (!transfer->notHtml)
+                result.status = CURLE_OK;
+            stoppedEarly++;
+            curl_off_t length = -1;
+            curl_off_t downloaded = 0;
+            curl_easy_getinfo(curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &length);
+            curl_easy_getinfo(curl, CURLINFO_SIZE_DOWNLOAD_T, &downloaded);
+            if (length >= downloaded && downloaded >= 0)
+            {
+                bytesSaved += static_cast<size_t>(length - downloaded);
+                savedPages++;
+            }
+        }
+        if (!transfer->redirects.empty())
+        {
+            char *effective = nullptr;
+            curl_easy_getinfo(curl, CURLINFO_EFFECTIVE_URL, &effective);
+            if (effective)
+                result.effectiveUrl = effective;
+            result.redirects = std::move(transfer->redirects);
+        }
+        if (scanBodies)
+        {
+            auto start = std::chrono::steady_clock::now();
+            if (!transfer->scanner)
+            {
+                // Empty body: nothing was fed, but the page still gets its defaults
+                transfer->metadata.url = result.url;
+                transfer->scanner = std::make_unique<LinkScanner>(transfer->metadata);
+            }
+            transfer->scanner->finish();
+            scanNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - start).count();
+            result.metadata = std::move(transfer->metadata);
+            result.scanned = true;
+        }
+
+        long connects = 0;
+        curl_easy_getinfo(curl, CURLINFO_NUM_CONNECTS, &connects);
+        // A failed transfer that opened nothing (DNS failure, refused, timed out
+        // before connecting) did not reuse anything either. Head-only stops
+        // count: their request went out on the connection.
+        if (connects > 0)
+            connectionsOpened += connects;
+        else if (result.status == CURLE_OK)
+            connectionsReused++;
+        if (share)
+            share->recordTransfer(curl);
+        completedCount++;
+
+        releaseHandle(curl);
+        active.erase(transfer);
+        delete transfer;
+
+        // A transfer counts as in flight until a parser can actually see it
+        if (!overflow.empty() || !completed.push(std::move(result)))
+        {
+            overflow.push_back(std::move(result));
+            continue;
+        }
+        inFlight--;
+    }
+}
+
+bool FetchEngine::flushOverflow()
+{
+    while (!overflow.empty())
+    {
+        if (!completed.push(std::move(overflow.front())))
+            return false;
+        overflow.pop_front();
+        inFlight--;
+    }
+    return true;
+}
+
+void FetchEngine::run()
+{
+    const int maxEvents = 256;
+    epoll_event events[maxEvents];
+    int running = 0;
+
+    while (!stopping)
+    {
+        // Backpressure: parsers are behind, so hold off on new transfers
+        bool drained = flushOverflow();
+        if (drained)
+            addPending();
+
+        int n = epoll_wait(epollFd, events, maxEvents, drained ? 1000 : 10);
+        if (n < 0 && errno != EINTR)
+        {
+            std::cerr << "epoll_wait failed: " << errno << std::endl;
+            break;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            int fd = events[i].data.fd;
+            if (fd == wakeFd)
+            {
+                uint64_t count;
+                (void)!read(wakeFd, &count, sizeof(count));
+            }
+            else if (fd == timerFd)
+            {
+                uint64_t expirations;
+                (void)!read(timerFd, &expirations, sizeof(expirations));
+                curl_multi_socket_action(multi, CURL_SOCKET_TIMEOUT, 0, &running);
+            }
+            else
+            {
+                int flags = 0;
+                if (events[i].events & EPOLLIN)
+                    flags |= CURL_CSELECT_IN;
+                if (events[i].events & EPOLLOUT)
+                    flags |= CURL_CSELECT_OUT;
+                if (events[i].events & (EPOLLERR | EPOLLHUP))
+                    flags |= CURL_CSELECT_ERR;
+                curl_multi_socket_action(multi, fd, flags, &running);
+            }
+        }
+
+        drainCompleted();
+    }
+
+    // Abandon whatever is still on the wire
+    for (Transfer *transfer : active)
+    {
+        releaseHandle(transfer->easy);
+        delete transfer;
+    }
+    active.clear();
+    overflow.clear();
+    inFlight = 0;
+}
@@ -0,0 +1,636 @@
+#include "link_scanner.h"
+#include "page_extractors.h"
+#include "url_normalizer.h"
+#include <cstring>
+#include <algorithm>
+#include <string_view>
+#include <vector>
+#include <strings.h>
+#if defined(__x86_64__)
+#include <immintrin.h>
+#endif
+
+// Index of the first c in p[from, n), or n
+using FindByte = size_t (*)(const char *p, size_t from, size_t n, char c);
+
+static size_t findScalar(const char *p, size_t from, size_t n, char c)
+{
+    for (size_t i = from; i < n; ++i)
+    {
+        if (p[i] == c)
+            return i;
+    }
+    return n;
+}
+
+#if defined(__x86_64__)
+__attribute__((target("avx2"))) static size_t findAvx2(const char *p, size_t from, size_t n, char c)
+{
+    const __m256i needle = _mm256_set1_epi8(c);
+    size_t i = from;
+    for (; i + 32 <= n; i += 32)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(p + i));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, needle)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return findScalar(p, i, n, c);
+}
+
+static size_t findSse2(const char *p, size_t from, size_t n, char c)
+{
+    const __m128i needle = _mm_set1_epi8(c);
+    size_t i = from;
+    for (; i + 16 <= n; i += 16)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(p + i));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, needle)));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    return findScalar(p, i, n, c);
+}
+#endif
+
+struct Isa
+{
+    const char *name;
+    FindByte find;
+};
+
+static Isa detectIsa()
+{
+#if defined(__x86_64__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return {"avx2", findAvx2};
+    return {"sse2", findSse2};
+#else
+    return {"scalar", findScalar};
+#endif
+}
+
+static Isa isa = detectIsa();
+
+const char *linkScannerIsa()
+{
+    return isa.name;
+}
+
+bool selectLinkScannerIsa(const std::string &name)
+{
+    if (name == "scalar")
+    {
+        isa = {"scalar", findScalar};
+        return true;
+    }
+#if defined(__x86_64__)
+    if (name == "sse2")
+    {
+        isa = {"sse2", findSse2};
+        return true;
+    }
+    if (name == "avx2" && __builtin_cpu_supports("avx2"))
+    {
+        isa = {"avx2", findAvx2};
+        return true;
+    }
+#endif
+    return false;
+}
+
+static bool isSpace(char c)
+{
+    return c == ' ' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+static bool isAlpha(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool equalsLower(std::string_view text, const char *lower)
+{
+    return text.size() == strlen(lower) && strncasecmp(text.data(), lower, text.size()) == 0;
+}
+
+static void appendUtf8(std::string &out, unsigned long cp)
+{
+    if (cp == 0 || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF))
+        cp = 0xFFFD;
+    if (cp < 0x80)
+        out += static_cast<char>(cp);
+    else if (cp < 0x800)
+    {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else if (cp < 0x10000)
+    {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+    else
+    {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+// Character references terminated by ';' and CR/CRLF line ends, the cases
+// real links and titles contain. Other named references are kept as written.
+static void decodeText(std::string_view in, std::string &out)
+{
+    static const struct
+    {
+        const char *name;
+        const char *text;
+    } kNamed[] = {{"amp", "&"}, {"lt", "<"}, {"gt", ">"}, {"quot", "\""}, {"apos", "'"}, {"nbsp", "\xC2\xA0"}};
+
+    out.reserve(in.size());
+    for (size_t i = 0; i < in.size(); ++i)
+    {
+        char c = in[i];
+        if (c == '\r')
+        {
+            out += '\n';
+            if (i + 1 < in.size() && in[i + 1] == '\n')
+                ++i;
+            continue;
+        }
+        size_t semicolon = c == '&' ? in.find(';', i + 1) : std::string_view::npos;
+        if (semicolon == std::string_view::npos || semicolon - i > 10)
+        {
+            out += c;
+            continue;
+        }
+
+        std::string_view name = in.substr(i + 1, semicolon - i - 1);
+        if (name.size() > 1 && name[0] == '#')
+        {
+            bool hex = name[1] == 'x' || name[1] == 'X';
+            std::string digits(name.substr(hex ? 2 : 1));
+            char *end = nullptr;
+            unsigned long cp = digits.empty() ? 0 : strtoul(digits.c_str(), &end, hex ? 16 : 10);
+            if (!digits.empty() && *end == '\0')
+            {
+                appendUtf8(out, cp);
+                i = semicolon;
+                continue;
+            }
+        }
+        else
+        {
+            bool matched = false;
+            for (const auto &entity : kNamed)
+            {
+                if (name == entity.name)
+                {
+                    out += entity.text;
+                    matched = true;
+                    break;
+                }
+            }
+            if (matched)
+            {
+                i = semicolon;
+                continue;
+            }
+        }
+        out += c;
+    }
+}
+
+// Start tags the parser keeps in <head>; any other one starts the body
+static const char *const kHeadTags[] = {"html", "head", "base", "basefont", "bgsound", "link", "meta", "title",
+                                        "noscript", "noframes", "style", "script", "template"};
+
+static const char *const kRawTextTags[] = {"title", "script", "style", "textarea", "xmp", "iframe", "noembed",
+                                           "noframes"};
+
+LinkScanner::LinkScanner(PageMetadata &page)
+    : metadata(page), find(isa.find)
+{
+}
+
+std::string_view LinkScanner::text(std::string_view raw, int slot)
+{
+    if (raw.find_first_of("&\r") == std::string_view::npos)
+        return raw;
+    scratch[slot].clear();
+    decodeText(raw, scratch[slot]);
+    return scratch[slot];
+}
+
+void LinkScanner::addHref(std::string_view href)
+{
+    if (baseUrl.empty())
+        baseUrl = metadata.url;
+    if (!haveBase)
+        rawHrefs.emplace_back(href);
+    // Canonical form, so different spellings of one page dedup to one entry
+    std::string url = resolveUrl(baseUrl, std::string(href));
+    if (!url.empty())
+        metadata.links.push_back(std::move(url));
+}
+
+void LinkScanner::setBase(std::string_view href)
+{
+    // Only the first <base> counts, and it applies to links before it too
+    haveBase = true;
+    std::string resolved = resolveUrl(metadata.url, std::string(href));
+    if (!resolved.empty() && resolved != baseUrl)
+    {
+        baseUrl = resolved;
+        metadata.links.clear();
+        for (const auto &raw : rawHrefs)
+        {
+            std::string url = resolveUrl(baseUrl, raw);
+            if (!url.empty())
+                metadata.links.push_back(std::move(url));
+        }
+    }
+    rawHrefs.clear();
+}
+
+void LinkScanner::endHead(size_t at)
+{
+    if (headEndOffset == std::string::npos)
+        headEndOffset = bufferOffset + at;
+}
+
+// Parses the start tag whose name begins at p[i]; returns the index after
+// its '>', or npos if the chunk ends first and more input may follow, in
+// which case progress records how far it got. resume is the progress of an
+// earlier call on the same tag, if any.
+size_t LinkScanner::startTag(const char *p, size_t i, size_t n, bool final, const Progress *resume)
+{
+    size_t tagStart = i - 1;
+    size_t nameStart = i;
+    while (i < n && !isSpace(p[i]) && p[i] != '/' && p[i] != '>')
+        ++i;
+    std::string_view tag(p + nameStart, i - nameStart);
+
+    // The two attributes this tag can contribute, by name
+    const char *wanted[2] = {nullptr, nullptr};
+    std::string_view values[2];
+    bool found[2] = {false, false};
+    bool isA = equalsLower(tag, "a");
+    bool isBase = !isA && equalsLower(tag, "base");
+    bool isLink = !isA && !isBase && equalsLower(tag, "link");
+    bool isMeta = !isA && !isBase && !isLink && equalsLower(tag, "meta");
+    if (isA || isLink)
+    {
+        wanted[0] = "href";
+        wanted[1] = "rel";
+    }
+    else if (isBase)
+        wanted[0] = "href";
+    else if (isMeta)
+    {
+        wanted[0] = "name";
+        wanted[1] = "content";
+    }
+
+    // The attributes before resume->attribute were parsed by an earlier call
+    size_t searched = 0;
+    if (resume && resume->attribute > 0)
+    {
+        i = tagStart + resume->attribute;
+        searched = tagStart + resume->searched;
+        for (int k = 0; k < 2; ++k)
+        {
+            found[k] = resume->found[k];
+            values[k] = std::string_view(p + tagStart + resume->valueBegin[k], resume->valueEnd[k] - resume->valueBegin[k]);
+        }
+    }
+
+    bool closed = false;
+    size_t attributeStart = i;
+    bool inValue = false;
+    while (i < n)
+    {
+        while (i < n && (isSpace(p[i]) || p[i] == '/'))
+            ++i;
+        if (i >= n)
+            break;
+        if (p[i] == '>')
+        {
+            ++i;
+            closed = true;
+            break;
+        }
+
+        size_t nameBegin = i++;
+        while (i < n && !isSpace(p[i]) && p[i] != '/' && p[i] != '>' && p[i] != '=')
+            ++i;
+        std::string_view attribute(p + nameBegin, i - nameBegin);
+        while (i < n && isSpace(p[i]))
+            ++i;
+        if (i >= n && !final)
+            break; // An '=' may follow in the next chunk
+
+        std::string_view value(p + i, 0);
+        if (i < n && p[i] == '=')
+        {
+            ++i;
+            while (i < n && isSpace(p[i]))
+                ++i;
+            // Only the value an earlier call was cut off in has been searched
+            size_t from = attributeStart == tagStart + (resume ? resume->attribute : 0) ? searched : 0;
+            inValue = true;
+            bool cut;
+            if (i < n && (p[i] == '"' || p[i] == '\''))
+            {
+                char quote = p[i++];
+                size_t end = find(p, std::max(i, from), n, quote);
+                value = std::string_view(p + i, end - i);
+                cut = end >= n;
+                i = end < n ? end + 1 : n;
+            }
+            else
+            {
+                size_t valueStart = i;
+                i = std::max(i, from);
+                while (i < n && !isSpace(p[i]) && p[i] != '>')
+                    ++i;
+                value = std::string_view(p + valueStart, i - valueStart);
+                cut = i >= n;
+            }
+            if (cut && !final)
+                break;
+            inValue = false;
+        }
+
+        for (int k = 0; k < 2; ++k)
+        {
+            if (wanted[k] && !found[k] && equalsLower(attribute, wanted[k]))
+            {
+                found[k] = true;
+                values[k] = value;
+            }
+        }
+        attributeStart = i;
+    }
+    if (!closed && !final)
+    {
+        progress.attribute = attributeStart - tagStart;
+        progress.searched = inValue ? n - tagStart : 0;
+        for (int k = 0; k < 2; ++k)
+        {
+            progress.found[k] = found[k];
+            progress.valueBegin[k] = found[k] ? static_cast<size_t>(values[k].data() - p) - tagStart : 0;
+            progress.valueEnd[k] = progress.valueBegin[k] + values[k].size();
+        }
+        return std::string::npos;
+    }
+
+    if (headEndOffset == std::string::npos &&
+        std::none_of(std::begin(kHeadTags), std::end(kHeadTags), [&](const char *name) { return equalsLower(tag, name); }))
+        endHead(nameStart - 1);
+
+    if (isA && found[0])
+    {
+        if (found[1] && hasToken(text(values[1], 1), "nofollow"))
+            metadata.nofollowLinks++;
+        else
+            addHref(text(values[0], 0));
+    }
+    else if (isBase && found[0] && !haveBase)
+    {
+        setBase(text(values[0], 0));
+    }
+    else if (isLink && found[0] && found[1] && !haveCanonical && hasToken(text(values[1], 1), "canonical"))
+    {
+        haveCanonical = true;
+        rawCanonical = std::string(text(values[0], 0));
+    }
+    else if (isMeta && found[0] && found[1])
+    {
+        std::string_view name = text(values[0], 0);
+        std::string_view content = text(values[1], 1);
+        if (!haveDescription && name == "description")
+        {
+            metadata.description = std::string(content);
+            haveDescription = true;
+        }
+        if (equalsLower(name, "robots"))
+        {
+            bool none = hasToken(content, "none");
+            metadata.noindex |= none || hasToken(content, "noindex");
+            metadata.nofollow |= none || hasToken(content, "nofollow");
+        }
+    }
+    else if (equalsLower(tag, "plaintext"))
+    {
+        state = State::Plaintext;
+    }
+    else
+    {
+        // Markup inside these is text, so an <a> in a script is not a link
+        for (const char *name : kRawTextTags)
+        {
+            if (equalsLower(tag, name))
+            {
+                state = State::RawText;
+                rawTextTag = name;
+                capturingTitle = !haveTitle && rawTextTag == "title";
+                break;
+            }
+        }
+    }
+    return i;
+}
+
+// Consumes p[0, n) as far as it can; returns how much it consumed. Unless
+// final, a construct cut off by the end is left for the next call.
+size_t LinkScanner::scan(const char *p, size_t n, bool final)
+{
+    size_t i = 0;
+    size_t commentStart = 0; // the dashes that open a comment cannot also close it
+    // Only the construct at p[0] can have been cut off by an earlier call
+    Progress resume = progress;
+    progress = Progress();
+    auto searchFrom = [&](size_t k, size_t from) { return k == 0 ? std::max(from, resume.searched) : from; };
+    auto cutAt = [&](size_t k) {
+        progress.searched = n - k;
+        return k;
+    };
+    while (i < n)
+    {
+        if (state == State::Plaintext)
+            return n;
+
+        if (state == State::Comment)
+        {
+            // Ends at "-->" or "--!>"; the last three bytes are kept since they may start one
+            size_t k = find(p, i, n, '>');
+            if (k >= n)
+                return final ? n : std::max(i, n >= 3 ? n - 3 : 0);
+            if ((k >= commentStart + 2 && p[k - 1] == '-' && p[k - 2] == '-') ||
+                (k >= commentStart + 3 && p[k - 1] == '!' && p[k - 2] == '-' && p[k - 3] == '-'))
+                state = State::Markup;
+            i = k + 1;
+            continue;
+        }
+
+        if (state == State::RawText)
+        {
+            size_t k = find(p, i, n, '<');
+            size_t nameEnd = k + 2 + rawTextTag.size();
+            if (k < n && nameEnd >= n && !final)
+            {
+                // Not enough bytes yet to tell whether this is the end tag
+                if (capturingTitle)
+                    titleText.append(p + i, k - i);
+                return k;
+            }
+            bool endTag = k < n && nameEnd < n && p[k + 1] == '/' &&
+                          strncasecmp(p + k + 2, rawTextTag.data(), rawTextTag.size()) == 0 &&
+                          (isSpace(p[nameEnd]) || p[nameEnd] == '/' || p[nameEnd] == '>');
+            if (!endTag)
+            {
+                size_t end = k < n ? k + 1 : n;
+                if (capturingTitle)
+                    titleText.append(p + i, end - i);
+                i = end;
+                continue;
+            }
+            size_t close = find(p, searchFrom(k, nameEnd), n, '>');
+            if (close >= n && !final)
+            {
+                if (capturingTitle)
+                    titleText.append(p + i, k - i);
+                return cutAt(k);
+            }
+            if (capturingTitle)
+            {
+                titleText.append(p + i, k - i);
+                std::string title;
+                decodeText(titleText, title);
+                metadata.title = std::move(title);
+                haveTitle = true;
+                capturingTitle = false;
+            }
+            if (rawTextTag == "title")
+                haveTitle = true;
+            state = State::Markup;
+            i = close < n ? close + 1 : n;
+            continue;
+        }
+
+        size_t k = find(p, i, n, '<');
+        if (k >= n)
+            return n;
+        if (k + 1 >= n)
+            return final ? n : k;
+        char c = p[k + 1];
+        if (isAlpha(c))
+        {
+            size_t end = startTag(p, k + 1, n, final, k == 0 ? &resume : nullptr);
+            if (end == std::string::npos)
+                return k;
+            i = end;
+        }
+        else if (c == '!')
+        {
+            if (k + 4 > n && !final && std::string_view("<!--").substr(0, n - k) == std::string_view(p + k, n - k))
+                return k;
+            if (k + 4 <= n && p[k + 2] == '-' && p[k + 3] == '-')
+            {
+                // "<!-->" and "<!--->" are empty comments
+                size_t j = k + 4;
+                if (j < n && p[j] == '>')
+                    i = j + 1;
+                else if (j + 1 < n && p[j] == '-' && p[j + 1] == '>')
+                    i = j + 2;
+                else if (!final && (j >= n || (j + 1 >= n && p[j] == '-')))
+                    return k;
+                else
+                {
+                    state = State::Comment;
+                    commentStart = j;
+                    i = j;
+                }
+            }
+            else
+            {
+                size_t close = find(p, searchFrom(k, k + 2), n, '>');
+                if (close >= n && !final)
+                    return cutAt(k);
+                i = close < n ? close + 1 : n;
+            }
+        }
+        else if (c == '/' || c == '?')
+        {
+            // End tags, and bogus comments such as <?xml ...>
+            size_t close = find(p, searchFrom(k, k + 2), n, '>');
+            if (close >= n && !final)
+                return cutAt(k);
+            if (c == '/' && headEndOffset == std::string::npos)
+            {
+                size_t nameEnd = k + 2;
+                while (nameEnd < close && !isSpace(p[nameEnd]) && p[nameEnd] != '/')
+                    ++nameEnd;
+                std::string_view name(p + k + 2, nameEnd - k - 2);
+                if (equalsLower(name, "head") || equalsLower(name, "body") || equalsLower(name, "html"))
+                    endHead(k);
+            }
+            i = close < n ? close + 1 : n;
+        }
+        else
+        {
+            i = k + 1;
+        }
+    }
+    return n;
+}
+
+void LinkScanner::feed(const char *data, size_t size)
+{
+    bufferOffset = fedBytes - pending.size();
+    fedBytes += size;
+    if (pending.empty())
+    {
+        size_t used = scan(data, size, false);
+        pending.assign(data + used, size - used);
+    }
+    else
+    {
+        pending.append(data, size);
+        size_t used = scan(pending.data(), pending.size(), false);
+        pending.erase(0, used);
+    }
+}
+
+void LinkScanner::finish()
+{
+    bufferOffset = fedBytes - pending.size();
+    scan(pending.data(), pending.size(), true);
+    pending.clear();
+
+    // A title left open at the end of the document runs to the end
+    if (capturingTitle)
+    {
+        std::string title;
+        decodeText(titleText, title);
+        metadata.title = std::move(title);
+    }
+    if (metadata.title.empty())
+        metadata.title = "No title";
+    if (!haveDescription)
+        metadata.description = "No description";
+    if (haveCanonical)
+        metadata.canonical = resolveUrl(baseUrl.empty() ? metadata.url : baseUrl, rawCanonical);
+}
+
+void scanPage(const std::string &html, PageMetadata &metadata)
+{
+    LinkScanner scanner(metadata);
+    scanner.feed(html.data(), html.size());
+    scanner.finish();
+}
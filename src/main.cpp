@@ -1,4 +1,5 @@
 #include "web_crawler.h"
+#include "link_scanner.h"
 #include <iostream>
 #include <unistd.h>
 #include <sys/types.h>
@@ -6,9 +7,25 @@
 
 int main(int argc, char *argv[])
 {
-    if (argc != 4)
+    if (argc < 4)
     {
-        std::cout << "Usage: " << argv[0] << " <seed_url> <num_threads> <depth_level>" << std::endl;
+        std::cout << "Usage: " << argv[0] << " <seed_url> <num_threads> <depth_level> [options]" << std::endl;
+        std::cout << "  --visited=strings|fp64|fp128|bloom   how the visited set stores URLs (default strings)" << std::endl;
+        std::cout << "  --expected-urls=N                    crawl size used to size the Bloom filter" << std::endl;
+        std::cout << "  --bloom-fp=RATE                      Bloom false-positive budget (default 0.01)" << std::endl;
+        std::cout << "  --frontier-memory=MB                 frontier memory before spilling to disk (default 512, 0 = unbounded)" << std::endl;
+        std::cout << "  --checkpoint-interval=SEC            seconds between crawl snapshots (default 300, 0 = no snapshots or log)" << std::endl;
+        std::cout << "  --wal-commit-ms=N                    write-ahead log group commit interval (default 5)" << std::endl;
+        std::cout << "  --query-rules=FILE|none              per-host query parameter rules (default: built-in)" << std::endl;
+        std::cout << "  --trap-max-url=N                     longest URL enqueued (default 1024)" << std::endl;
+        std::cout << "  --trap-fanout=N                      new URLs per host path pattern (default 1000)" << std::endl;
+        std::cout << "  --trap-quarantine=N                  trap rejections before a pattern is quarantined (default 200)" << std::endl;
+        std::cout << "  --traps=off                          disable crawler-trap detection" << std::endl;
+        std::cout << "  --extract=dom|scan|compare           Gumbo tree, raw link scanner, or both checked against each other" << std::endl;
+        std::cout << "  --scan-isa=avx2|sse2|scalar          force the link scanner's byte search (default: best available)" << std::endl;
+        std::cout << "  --head-only=KB                       metadata mode: scan while receiving, stop KB after </head>, skip non-HTML" << std::endl;
+        std::cout << "  --parse-arena=off                    allocate Gumbo trees with malloc instead of a per-thread arena" << std::endl;
+        std::cout << "  --resume                             continue from the snapshot and log in crawler_state" << std::endl;
         return 1;
     }
 
@@ -16,6 +33,78 @@ int main(int argc, char *argv[])
     int num_threads = std::atoi(argv[2]);
     int depth_level = std::atoi(argv[3]);
 
+    CrawlerOptions options;
+    for (int i = 4; i < argc; i++)
+    {
+        std::string arg = argv[i];
+        if (arg == "--visited=strings")
+            options.visitedMode = VisitedMode::Strings;
+        else if (arg == "--visited=fp64")
+            options.visitedMode = VisitedMode::Fingerprint64;
+        else if (arg == "--visited=fp128")
+            options.visitedMode = VisitedMode::Fingerprint128;
+        else if (arg == "--visited=bloom")
+            options.visitedMode = VisitedMode::Bloom;
+        else if (arg.rfind("--expected-urls=", 0) == 0)
+            options.expectedUrls = std::strtoull(arg.c_str() + 16, nullptr, 10);
+        else if (arg.rfind("--bloom-fp=", 0) == 0)
+            options.bloomFalsePositiveRate = std::atof(arg.c_str() + 11);
+        else if (arg.rfind("--frontier-memory=", 0) == 0)
+            options.frontierMemoryBytes = std::strtoull(arg.c_str() + 18, nullptr, 10) << 20;
+        else if (arg.rfind("--checkpoint-interval=", 0) == 0)
+            options.checkpointIntervalSec = std::atoi(arg.c_str() + 22);
+        else if (arg.rfind("--wal-commit-ms=", 0) == 0)
+            options.walCommitMs = std::atoi(arg.c_str() + 16);
+        else if (arg == "--query-rules=none")
+            options.queryRules = false;
+        else if (arg.rfind("--query-rules=", 0) == 0)
+            options.queryRulesFile = arg.substr(14);
+        else if (arg.rfind("--trap-max-url=", 0) == 0)
+            options.trapLimits.maxUrlLength = std::strtoull(arg.c_str() + 15, nullptr, 10);
+        else if (arg.rfind("--trap-fanout=", 0) == 0)
+            options.trapLimits.maxPatternFanout = std::strtoull(arg.c_str() + 14, nullptr, 10);
+        else if (arg.rfind("--trap-quarantine=", 0) == 0)
+            options.trapLimits.quarantineAfter = std::strtoull(arg.c_str() + 18, nullptr, 10);
+        else if (arg == "--traps=off")
+            options.trapDetection = false;
+        else if (arg == "--extract=dom")
+            options.extractMode = ExtractMode::Dom;
+        else if (arg == "--extract=scan")
+            options.extractMode = ExtractMode::Scan;
+        else if (arg == "--extract=compare")
+            options.extractMode = ExtractMode::Compare;
+        else if (arg.rfind("--scan-isa=", 0) == 0)
+        {
+            if (!selectLinkScannerIsa(arg.substr(11)))
+            {
+                std::cerr << "Error: Link scanner cannot use " << arg.substr(11) << " here" << std::endl;
+                return 1;
+            }
+        }
+        else if (arg.rfind("--head-only=", 0) == 0)
+        {
+            const char *value = arg.c_str() + 12;
+            char *end = nullptr;
+            unsigned long long kb = std::strtoull(value, &end, 10);
+            if (*value < '0' || *value > '9' || *end != '\0' || kb == 0)
+            {
+                std::cerr << "Error: --head-only needs a positive number of KB, got " << value << std::endl;
+                return 1;
+            }
+            options.headOnlyBytes = static_cast<size_t>(kb) << 10;
+            options.extractMode = ExtractMode::Scan;
+        }
+        else if (arg == "--parse-arena=off")
+            options.parseArena = false;
+        else if (arg == "--resume")
+            options.resume = true;
+        else
+        {
+            std::cerr << "Error: Unknown option " << arg << std::endl;
+            return 1;
+        }
+    }
+
     // Basic validation of num_threads and depth_level
     if (num_threads <= 0 || depth_level < 0)
     {
@@ -35,7 +124,10 @@ int main(int argc, char *argv[])
         }
         if (pid == 0)
         {
-            WebCrawler crawler(num_threads, depth_level, 1000);
+            options.threads = num_threads;
+            options.depth = depth_level;
+            options.delayMs = 1000;
+            WebCrawler crawler(options);
             crawler.start(seed_url);
             crawler.waitForCompletion();
         }
@@ -0,0 +1,170 @@
+#include "page_extractors.h"
+#include "url_normalizer.h"
+#include "parse_arena.h"
+#include <cstring>
+#include <strings.h>
+
+static bool isListSeparator(char c)
+{
+    return c == ' ' || c == ',' || c == '\t' || c == '\n' || c == '\r' || c == '\f';
+}
+
+bool hasToken(std::string_view list, std::string_view token)
+{
+    size_t i = 0;
+    while (i < list.size())
+    {
+        while (i < list.size() && isListSeparator(list[i]))
+            ++i;
+        size_t start = i;
+        while (i < list.size() && !isListSeparator(list[i]))
+            ++i;
+        if (i - start == token.size() && strncasecmp(list.data() + start, token.data(), token.size()) == 0)
+            return true;
+    }
+    return false;
+}
+
+void resolvePageLinks(PageMetadata &metadata, std::string_view base, const std::vector<std::string_view> &hrefs,
+                      std::string_view canonical)
+{
+    std::string baseUrl = metadata.url;
+    if (base.data())
+    {
+        std::string resolved = resolveUrl(metadata.url, std::string(base));
+        if (!resolved.empty())
+            baseUrl = resolved;
+    }
+
+    metadata.links.reserve(hrefs.size());
+    for (std::string_view href : hrefs)
+    {
+        // Canonical form, so different spellings of one page dedup to one entry
+        std::string url = resolveUrl(baseUrl, std::string(href));
+        if (!url.empty())
+        {
+            metadata.links.push_back(std::move(url));
+        }
+    }
+    if (canonical.data())
+        metadata.canonical = resolveUrl(baseUrl, std::string(canonical));
+}
+
+void TitleExtractor::visit(const GumboElement &element)
+{
+    if (found || element.tag != GUMBO_TAG_TITLE)
+        return;
+    found = true;
+    if (element.children.length > 0)
+    {
+        const GumboNode *text = static_cast<const GumboNode *>(element.children.data[0]);
+        if (text->type == GUMBO_NODE_TEXT || text->type == GUMBO_NODE_WHITESPACE)
+            metadata.title = text->v.text.text;
+    }
+}
+
+void TitleExtractor::finish()
+{
+    if (metadata.title.empty())
+        metadata.title = "No title";
+}
+
+void DescriptionExtractor::visit(const GumboElement &element)
+{
+    if (found || element.tag != GUMBO_TAG_META)
+        return;
+    GumboAttribute *name = gumbo_get_attribute(&element.attributes, "name");
+    if (name && strcmp(name->value, "description") == 0)
+    {
+        GumboAttribute *content = gumbo_get_attribute(&element.attributes, "content");
+        if (content)
+        {
+            metadata.description = content->value;
+            found = true;
+        }
+    }
+}
+
+void DescriptionExtractor::finish()
+{
+    if (!found)
+        metadata.description = "No description";
+}
+
+void RobotsExtractor::visit(const GumboElement &element)
+{
+    if (element.tag != GUMBO_TAG_META)
+        return;
+    GumboAttribute *name = gumbo_get_attribute(&element.attributes, "name");
+    GumboAttribute *content = gumbo_get_attribute(&element.attributes, "content");
+    if (name && content && strcasecmp(name->value, "robots") == 0)
+    {
+        bool none = hasToken(content->value, "none");
+        metadata.noindex |= none || hasToken(content->value, "noindex");
+        metadata.nofollow |= none || hasToken(content->value, "nofollow");
+    }
+}
+
+void LinkExtractor::visit(const GumboElement &element)
+{
+    switch (element.tag)
+    {
+    case GUMBO_TAG_A:
+    {
+        GumboAttribute *href = gumbo_get_attribute(&element.attributes, "href");
+        GumboAttribute *rel = gumbo_get_attribute(&element.attributes, "rel");
+        if (href && rel && hasToken(rel->value, "nofollow"))
+            metadata.nofollowLinks++;
+        else if (href)
+            hrefs.push_back(href->value);
+        break;
+    }
+    case GUMBO_TAG_BASE:
+    {
+        // Only the first <base> with an href counts
+        GumboAttribute *href = gumbo_get_attribute(&element.attributes, "href");
+        if (href && !base.data())
+            base = href->value;
+        break;
+    }
+    case GUMBO_TAG_LINK:
+    {
+        GumboAttribute *rel = gumbo_get_attribute(&element.attributes, "rel");
+        GumboAttribute *href = gumbo_get_attribute(&element.attributes, "href");
+        if (rel && href && !canonical.data() && hasToken(rel->value, "canonical"))
+            canonical = href->value;
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+void LinkExtractor::finish()
+{
+    resolvePageLinks(metadata, base, hrefs, canonical);
+}
+
+void extractPage(const std::string &html, PageMetadata &metadata, ParseArena *arena)
+{
+    GumboOptions options = kGumboDefaultOptions;
+    if (arena)
+    {
+        options.allocator = ParseArena::gumboAllocate;
+        options.deallocator = ParseArena::gumboDeallocate;
+        options.userdata = arena;
+    }
+
+    GumboOutput *output = gumbo_parse_with_options(&options, html.data(), html.size());
+    TitleExtractor title(metadata);
+    DescriptionExtractor description(metadata);
+    RobotsExtractor robots(metadata);
+    LinkExtractor links(metadata);
+    walkDom(output->root, {&title, &description, &robots, &links});
+
+    // The extractors copied what they keep, so the tree can go
+    if (arena)
+        arena->reset();
+    else
+        gumbo_destroy_output(&options, output);
+}
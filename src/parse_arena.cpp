@@ -0,0 +1,91 @@
+#include "parse_arena.h"
+#include <algorithm>
+#include <mutex>
+
+// Every live arena, plus the totals of arenas whose thread has exited.
+// The lock is taken when an arena is created or destroyed and when stats
+// are read, never per page.
+static std::mutex registryMutex;
+static std::vector<ParseArena *> liveArenas;
+static ArenaStats retired;
+
+static void addTotals(ArenaStats &sum, size_t pages, size_t allocations, size_t bytes, size_t largestPage)
+{
+    sum.pages += pages;
+    sum.allocations += allocations;
+    sum.bytes += bytes;
+    sum.largestPage = std::max(sum.largestPage, largestPage);
+}
+
+ParseArena::ParseArena()
+{
+    blocks.emplace_back(new char[kInitialBlock]);
+    blockSizes.push_back(kInitialBlock);
+    cursor = blocks.back().get();
+    limit = cursor + kInitialBlock;
+    std::lock_guard<std::mutex> lock(registryMutex);
+    liveArenas.push_back(this);
+}
+
+ParseArena::~ParseArena()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    addTotals(retired, pages.load(), allocations.load(), bytes.load(), largestPage.load());
+    liveArenas.erase(std::find(liveArenas.begin(), liveArenas.end(), this));
+}
+
+void *ParseArena::allocateSlow(size_t size)
+{
+    // Grow geometrically so a large page needs only a few blocks
+    size_t blockSize = std::max(size, blockSizes.back() * 2);
+    blocks.emplace_back(new char[blockSize]);
+    blockSizes.push_back(blockSize);
+    cursor = blocks.back().get() + size;
+    limit = blocks.back().get() + blockSize;
+    return blocks.back().get();
+}
+
+void ParseArena::reset()
+{
+    pages.fetch_add(1, std::memory_order_relaxed);
+    allocations.fetch_add(pageAllocations, std::memory_order_relaxed);
+    bytes.fetch_add(pageBytes, std::memory_order_relaxed);
+    if (pageBytes > largestPage.load(std::memory_order_relaxed))
+        largestPage.store(pageBytes, std::memory_order_relaxed);
+    pageAllocations = 0;
+    pageBytes = 0;
+
+    if (blocks.size() > 1)
+    {
+        size_t total = 0;
+        for (size_t size : blockSizes)
+        {
+            total += size;
+        }
+        total = std::min(total, kMaxRetained);
+        blocks.clear();
+        blockSizes.clear();
+        blocks.emplace_back(new char[total]);
+        blockSizes.push_back(total);
+    }
+    cursor = blocks.front().get();
+    limit = cursor + blockSizes.front();
+}
+
+ParseArena &ParseArena::local()
+{
+    thread_local ParseArena arena;
+    return arena;
+}
+
+ArenaStats ParseArena::stats()
+{
+    std::lock_guard<std::mutex> lock(registryMutex);
+    ArenaStats sum = retired;
+    for (const ParseArena *arena : liveArenas)
+    {
+        addTotals(sum, arena->pages.load(std::memory_order_relaxed), arena->allocations.load(std::memory_order_relaxed),
+                  arena->bytes.load(std::memory_order_relaxed), arena->largestPage.load(std::memory_order_relaxed));
+    }
+    return sum;
+}
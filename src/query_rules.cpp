@@ -0,0 +1,242 @@
+#include "query_rules.h"
+#include "url_view.h"
+#include <algorithm>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+#include <string_view>
+
+static const char *const kDefaultRules[] = {
+    "* drop utm_*",
+    "* drop gclid",
+    "* drop fbclid",
+    "* drop sessionid",
+    "* drop jsessionid",
+    "* drop phpsessid",
+    "* sort",
+};
+
+static bool hostMatches(const std::string &pattern, std::string_view host)
+{
+    if (pattern == "*" || host == pattern)
+        return true;
+    return host.size() > pattern.size() && host[host.size() - pattern.size() - 1] == '.' &&
+           host.compare(host.size() - pattern.size(), pattern.size(), pattern) == 0;
+}
+
+static bool nameMatches(const QueryRules::Rule &rule, std::string_view name)
+{
+    if (rule.prefix ? name.size() < rule.parameter.size() : name.size() != rule.parameter.size())
+        return false;
+    for (size_t i = 0; i < rule.parameter.size(); ++i)
+    {
+        char c = name[i];
+        if (c >= 'A' && c <= 'Z')
+            c = static_cast<char>(c - 'A' + 'a');
+        if (c != rule.parameter[i])
+            return false;
+    }
+    return true;
+}
+
+QueryRules::QueryRules(const std::string &path)
+{
+    if (path.empty())
+    {
+        size_t lineNumber = 0;
+        for (const char *line : kDefaultRules)
+        {
+            addRule(line, ++lineNumber);
+        }
+    }
+    else
+    {
+        std::ifstream in(path);
+        if (!in)
+        {
+            throw std::runtime_error("Cannot read query rules " + path);
+        }
+        std::string line;
+        size_t lineNumber = 0;
+        while (std::getline(in, line))
+        {
+            addRule(line, ++lineNumber);
+        }
+    }
+
+    rewritten.reset(new std::atomic<size_t>[rules.size()]());
+    collapsed.reset(new std::atomic<size_t>[rules.size()]());
+}
+
+void QueryRules::addRule(const std::string &line, size_t lineNumber)
+{
+    std::string text = line.substr(0, line.find('#'));
+    std::istringstream fields(text);
+    std::string host, action, parameter, extra;
+    if (!(fields >> host))
+        return; // Blank or comment
+
+    // URLs reach apply() with their host already lowercased
+    std::transform(host.begin(), host.end(), host.begin(), ::tolower);
+    Rule rule;
+    rule.host = host;
+    fields >> action >> parameter >> extra;
+    if (action == "drop" && !parameter.empty() && extra.empty())
+    {
+        rule.action = Action::Drop;
+        rule.prefix = parameter.back() == '*';
+        if (rule.prefix)
+            parameter.pop_back();
+        std::transform(parameter.begin(), parameter.end(), parameter.begin(), ::tolower);
+        rule.parameter = parameter;
+    }
+    else if (action == "sort" && parameter.empty())
+    {
+        rule.action = Action::Sort;
+        rule.prefix = false;
+    }
+    else
+    {
+        throw std::runtime_error("Bad query rule on line " + std::to_string(lineNumber) + ": " + line);
+    }
+    if (rules.size() == kMaxRules)
+    {
+        throw std::runtime_error("Too many query rules, the limit is " + std::to_string(kMaxRules));
+    }
+
+    rule.text = host + " " + action + (rule.action == Action::Drop ? " " + parameter + (rule.prefix ? "*" : "") : "");
+    rules.push_back(std::move(rule));
+}
+
+uint64_t QueryRules::apply(std::string &url) const
+{
+    UrlView view(url);
+    if (!view.valid())
+        return 0;
+    std::string_view path = view.path();
+    size_t pathBegin = static_cast<size_t>(path.data() - url.data());
+    size_t pathEnd = pathBegin + path.size();
+    bool hasQuery = pathEnd < url.size() && url[pathEnd] == '?';
+    bool hasPathParameters = path.find(';') != std::string_view::npos;
+    if (!hasQuery && !hasPathParameters)
+        return 0; // Most links: nothing any rule could touch
+
+    uint64_t dropRules = 0;
+    uint64_t sortRules = 0;
+    std::string_view host = view.host();
+    for (size_t i = 0; i < rules.size(); ++i)
+    {
+        if (hostMatches(rules[i].host, host))
+            (rules[i].action == Action::Drop ? dropRules : sortRules) |= uint64_t(1) << i;
+    }
+    if (dropRules == 0 && sortRules == 0)
+        return 0;
+
+    auto dropMask = [&](std::string_view name) {
+        uint64_t mask = 0;
+        for (uint64_t bits = dropRules; bits; bits &= bits - 1)
+        {
+            size_t i = static_cast<size_t>(__builtin_ctzll(bits));
+            if (nameMatches(rules[i], name))
+                mask |= uint64_t(1) << i;
+        }
+        return mask;
+    };
+
+    uint64_t changed = 0;
+    std::string out;
+    out.reserve(url.size());
+    out.append(url, 0, pathBegin);
+
+    // ;name=value parameters inside path segments
+    size_t i = 0;
+    while (i < path.size())
+    {
+        size_t end = path.find_first_of(";/", i + 1);
+        if (end == std::string_view::npos)
+            end = path.size();
+        std::string_view piece = path.substr(i, end - i);
+        uint64_t mask = 0;
+        if (piece[0] == ';' && dropRules)
+        {
+            std::string_view name = piece.substr(1);
+            mask = dropMask(name.substr(0, name.find('=')));
+        }
+        if (mask)
+            changed |= mask;
+        else
+            out += piece;
+        i = end;
+    }
+
+    thread_local std::vector<std::string_view> parameters;
+    parameters.clear();
+    if (hasQuery)
+    {
+        std::string_view query = view.query();
+        size_t start = 0;
+        while (start <= query.size())
+        {
+            size_t end = query.find('&', start);
+            if (end == std::string_view::npos)
+                end = query.size();
+            std::string_view parameter = query.substr(start, end - start);
+            if (!parameter.empty())
+            {
+                uint64_t mask = dropRules ? dropMask(parameter.substr(0, parameter.find('='))) : 0;
+                if (mask)
+                    changed |= mask;
+                else
+                    parameters.push_back(parameter);
+            }
+            start = end + 1;
+        }
+        // Orders by name only and keeps repeated names (a=1&a=2, x[]=) in
+        // their original order, since servers read those as lists
+        auto byName = [](std::string_view a, std::string_view b) {
+            return a.substr(0, a.find('=')) < b.substr(0, b.find('='));
+        };
+        if (sortRules && !std::is_sorted(parameters.begin(), parameters.end(), byName))
+        {
+            std::stable_sort(parameters.begin(), parameters.end(), byName);
+            changed |= sortRules;
+        }
+    }
+
+    if (changed == 0)
+        return 0;
+    for (size_t p = 0; p < parameters.size(); ++p)
+    {
+        out += p == 0 ? '?' : '&';
+        out += parameters[p];
+    }
+    url.swap(out);
+
+    for (uint64_t bits = changed; bits; bits &= bits - 1)
+    {
+        rewritten[__builtin_ctzll(bits)].fetch_add(1, std::memory_order_relaxed);
+    }
+    return changed;
+}
+
+void QueryRules::recordCollapsed(uint64_t mask)
+{
+    for (; mask; mask &= mask - 1)
+    {
+        collapsed[__builtin_ctzll(mask)].fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+std::vector<QueryRuleStats> QueryRules::stats() const
+{
+    std::vector<QueryRuleStats> result;
+    for (size_t i = 0; i < rules.size(); ++i)
+    {
+        QueryRuleStats s;
+        s.rule = rules[i].text;
+        s.rewritten = rewritten[i].load();
+        s.collapsed = collapsed[i].load();
+        result.push_back(std::move(s));
+    }
+    return result;
+}
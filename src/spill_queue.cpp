@@ -0,0 +1,181 @@
+#include "spill_queue.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <unistd.h>
+
+static const size_t kRefillBatch = 4096;
+
+SpillQueue::SpillQueue(const std::string &prefix, size_t maxSegmentBytes)
+    : pathPrefix(prefix), segmentBytes(maxSegmentBytes)
+{
+}
+
+SpillQueue::~SpillQueue()
+{
+    writer.close();
+    reader.close();
+    for (const auto &segment : segments)
+    {
+        std::remove(segment.c_str());
+    }
+}
+
+bool SpillQueue::spill(const Item &item)
+{
+    auto start = std::chrono::steady_clock::now();
+    if (!writer.is_open())
+    {
+        std::string path = pathPrefix + "_" + std::to_string(nextSegment++) + ".seg";
+        writer.open(path, std::ios::binary | std::ios::trunc);
+        if (!writer)
+        {
+            std::cerr << "Cannot open frontier segment " << path << ", keeping URLs in memory" << std::endl;
+            return false;
+        }
+        segments.push_back(path);
+        writerBytes = 0;
+    }
+
+    uint32_t length = static_cast<uint32_t>(item.first.size());
+    int32_t depth = item.second;
+    writer.write(reinterpret_cast<const char *>(&length), sizeof(length));
+    writer.write(reinterpret_cast<const char *>(&depth), sizeof(depth));
+    writer.write(item.first.data(), length);
+    size_t bytes = sizeof(length) + sizeof(depth) + length;
+    writerBytes += bytes;
+    onDisk++;
+
+    if (writerBytes >= segmentBytes)
+    {
+        writer.close();
+    }
+
+    stats.spilledItems++;
+    stats.spilledBytes += bytes;
+    stats.spillSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    return true;
+}
+
+void SpillQueue::refill()
+{
+    auto start = std::chrono::steady_clock::now();
+    size_t loaded = 0;
+    while (loaded < kRefillBatch && !segments.empty())
+    {
+        if (!reader.is_open())
+        {
+            // Never read a segment that is still being appended to
+            if (segments.size() == 1 && writer.is_open())
+                writer.close();
+            reader.open(segments.front(), std::ios::binary);
+        }
+
+        uint32_t length;
+        int32_t depth;
+        if (reader.read(reinterpret_cast<char *>(&length), sizeof(length)) &&
+            reader.read(reinterpret_cast<char *>(&depth), sizeof(depth)))
+        {
+            std::string url(length, '\0');
+            if (reader.read(&url[0], length))
+            {
+                stats.refilledBytes += sizeof(length) + sizeof(depth) + length;
+                head.emplace_back(std::move(url), depth);
+                headBytes += itemBytes(head.back());
+                onDisk--;
+                loaded++;
+                continue;
+            }
+        }
+
+        // End of this segment: it has been consumed in full
+        reader.close();
+        reader.clear();
+        std::remove(segments.front().c_str());
+        segments.pop_front();
+    }
+
+    if (segments.empty())
+        onDisk = 0;
+    stats.refilledItems += loaded;
+    stats.refillSeconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+bool SpillQueue::push(Item item, bool toDisk)
+{
+    // Once spilling has started, everything queues behind the disk tail
+    if ((toDisk || onDisk > 0) && spill(item))
+    {
+        return true;
+    }
+    headBytes += itemBytes(item);
+    head.push_back(std::move(item));
+    return false;
+}
+
+bool SpillQueue::pop(Item &item)
+{
+    if (head.empty() && onDisk > 0)
+    {
+        refill();
+    }
+    if (head.empty())
+    {
+        return false;
+    }
+    headBytes -= itemBytes(head.front());
+    item = std::move(head.front());
+    head.pop_front();
+    return true;
+}
+
+void SpillQueue::unpop(Item item)
+{
+    headBytes += itemBytes(item);
+    head.push_front(std::move(item));
+}
+
+void SpillQueue::snapshot(std::vector<Item> &out, const std::string &linkPrefix, std::vector<SpillRange> &spilled)
+{
+    out.insert(out.end(), head.begin(), head.end());
+    if (writer.is_open())
+        writer.flush();
+
+    for (size_t i = 0; i < segments.size(); ++i)
+    {
+        SpillRange range;
+        range.path = linkPrefix + "_" + std::to_string(i) + ".seg";
+        if (link(segments[i].c_str(), range.path.c_str()) != 0)
+            throw std::runtime_error("Cannot link frontier segment " + segments[i] + " as " + range.path);
+        // Records before the reader's position are already in the head
+        if (i == 0 && reader.is_open())
+            range.begin = static_cast<uint64_t>(reader.tellg());
+        // Segments are append-only, so the bytes up to here never change
+        range.end = std::filesystem::file_size(range.path);
+        spilled.push_back(std::move(range));
+    }
+}
+
+bool SpillQueue::load(const SpillRange &range, std::vector<Item> &out)
+{
+    std::ifstream in(range.path, std::ios::binary);
+    in.seekg(static_cast<std::streamoff>(range.begin));
+    uint64_t offset = range.begin;
+    uint32_t length;
+    int32_t depth;
+    while (offset < range.end)
+    {
+        if (!in.read(reinterpret_cast<char *>(&length), sizeof(length)) ||
+            !in.read(reinterpret_cast<char *>(&depth), sizeof(depth)))
+            return false;
+        std::string url(length, '\0');
+        if (!in.read(&url[0], length))
+            return false;
+        out.emplace_back(std::move(url), depth);
+        offset += sizeof(length) + sizeof(depth) + length;
+    }
+    return offset == range.end;
+}
@@ -0,0 +1,154 @@
+#include "trap_detector.h"
+#include "url_view.h"
+#include "fingerprint.h"
+#include <string_view>
+
+TrapDetector::TrapDetector(const TrapLimits &trapLimits)
+    : limits(trapLimits)
+{
+}
+
+uint64_t TrapDetector::patternKey(const std::string &url)
+{
+    // host, then the path with digit runs folded to '#', then the query's parameter names
+    UrlView view(url);
+    thread_local std::string pattern;
+    pattern.assign(view.host());
+    pattern += '\0';
+    std::string_view path = view.path();
+    for (size_t i = 0; i < path.size(); ++i)
+    {
+        if (path[i] >= '0' && path[i] <= '9')
+        {
+            if (pattern.back() != '#')
+                pattern += '#';
+        }
+        else
+        {
+            pattern += path[i];
+        }
+    }
+
+    std::string_view query = view.query();
+    bool inName = !query.empty();
+    if (inName)
+        pattern += '?';
+    for (char c : query)
+    {
+        if (c == '&')
+        {
+            pattern += '&';
+            inName = true;
+        }
+        else if (c == '=')
+        {
+            inName = false;
+        }
+        else if (inName)
+        {
+            pattern += c;
+        }
+    }
+    return fingerprint128(pattern.data(), pattern.size()).lo;
+}
+
+bool TrapDetector::repeatsSegment(const std::string &url) const
+{
+    std::string_view path = UrlView(url).path();
+    std::string_view segments[64];
+    size_t count = 0;
+    size_t i = 0;
+    while (i < path.size())
+    {
+        size_t end = path.find('/', i + 1);
+        if (end == std::string_view::npos)
+            end = path.size();
+        std::string_view segment = path.substr(i, end - i);
+        i = end;
+        if (segment.size() <= 1)
+            continue; // "/" alone, from a trailing or doubled slash
+
+        size_t seen = 1;
+        for (size_t j = 0; j < count; ++j)
+        {
+            if (segments[j] == segment)
+                seen++;
+        }
+        if (seen > limits.maxSegmentRepeats || count == 64)
+            return true;
+        segments[count++] = segment;
+    }
+    return false;
+}
+
+void TrapDetector::reject(PatternState &pattern, size_t &counter)
+{
+    counter++;
+    if (++pattern.rejections >= limits.quarantineAfter && !pattern.quarantined)
+    {
+        pattern.quarantined = true;
+        counters.quarantinedPatterns++;
+    }
+}
+
+std::vector<bool> TrapDetector::check(const std::vector<std::string> &links, const std::vector<bool> &added)
+{
+    enum Verdict
+    {
+        Ok,
+        TooLong,
+        Repeats
+    };
+
+    // Everything that only needs the URL itself is worked out before the lock
+    std::vector<bool> accepted(links.size(), false);
+    std::vector<uint64_t> patternKeys(links.size());
+    std::vector<Verdict> verdicts(links.size(), Ok);
+    for (size_t i = 0; i < links.size(); ++i)
+    {
+        if (!added[i])
+            continue;
+        patternKeys[i] = patternKey(links[i]);
+        if (links[i].size() > limits.maxUrlLength)
+            verdicts[i] = TooLong;
+        else if (repeatsSegment(links[i]))
+            verdicts[i] = Repeats;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    for (size_t i = 0; i < links.size(); ++i)
+    {
+        if (!added[i])
+            continue;
+        PatternState &pattern = patterns[patternKeys[i]];
+        if (pattern.quarantined)
+        {
+            counters.quarantined++;
+        }
+        else if (verdicts[i] == TooLong)
+        {
+            reject(pattern, counters.tooLong);
+        }
+        else if (verdicts[i] == Repeats)
+        {
+            reject(pattern, counters.repeatedSegments);
+        }
+        else if (pattern.admitted >= limits.maxPatternFanout)
+        {
+            reject(pattern, counters.patternFanout);
+        }
+        else
+        {
+            accepted[i] = true;
+            if (++pattern.admitted == limits.maxPatternFanout)
+                counters.trappedPatterns++;
+        }
+    }
+    return accepted;
+}
+
+TrapStats TrapDetector::stats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return counters;
+}
@@ -0,0 +1,328 @@
+#include "url_frontier.h"
+#include "url_view.h"
+#include <algorithm>
+#include <filesystem>
+
+UrlFrontier::UrlFrontier(std::chrono::milliseconds delay, size_t frontQueueCount, size_t backQueueCount,
+                         size_t memoryLimit, const std::string &spillDir)
+    : backQueues(std::max<size_t>(1, backQueueCount)),
+      hostDelay(delay),
+      memoryCeiling(memoryLimit)
+{
+    namespace fs = std::filesystem;
+    if (memoryCeiling > 0)
+    {
+        // Segments from an earlier run describe a frontier that no longer exists
+        fs::create_directories(spillDir);
+        for (const auto &entry : fs::directory_iterator(spillDir))
+        {
+            std::string name = entry.path().filename().string();
+            if (name.rfind("frontier_", 0) == 0 && entry.path().extension() == ".seg")
+                fs::remove(entry.path());
+        }
+    }
+
+    size_t fronts = std::max<size_t>(1, frontQueueCount);
+    frontQueues.reserve(fronts);
+    for (size_t i = 0; i < fronts; ++i)
+    {
+        frontQueues.emplace_back(spillDir + "/frontier_" + std::to_string(i));
+    }
+
+    for (size_t i = backQueues.size(); i > 0; --i)
+    {
+        freeBackQueues.push_back(i - 1);
+    }
+}
+
+bool UrlFrontier::popFront(Item &item)
+{
+    for (auto &queue : frontQueues)
+    {
+        if (queue.pop(item))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+size_t UrlFrontier::frontQueueFor(const Item &item) const
+{
+    return std::min<size_t>(std::max(item.second, 0), frontQueues.size() - 1);
+}
+
+void UrlFrontier::pushFront(Item item)
+{
+    bool toDisk = memoryCeiling > 0 && memoryBytes() + SpillQueue::itemBytes(item) > memoryCeiling;
+    frontQueues[frontQueueFor(item)].push(std::move(item), toDisk);
+    count++;
+}
+
+size_t UrlFrontier::memoryBytes() const
+{
+    size_t total = backBytes + dispatchedBytes +
+                   hostNextAllowed.size() * (sizeof(std::pair<const uint64_t, Clock::time_point>) + kMapNodeBytes);
+    for (const auto &queue : frontQueues)
+    {
+        total += queue.memoryBytes();
+    }
+    return total;
+}
+
+void UrlFrontier::refill(size_t queue)
+{
+    Item item;
+    // Bounded, so a front full of one busy host is not walked on every call
+    for (size_t scanned = 0; scanned < kRefillScan && popFront(item); ++scanned)
+    {
+        uint64_t host = UrlView(item.first).hostKey();
+        auto owner = hostToBackQueue.find(host);
+        if (owner != hostToBackQueue.end())
+        {
+            BackQueue &back = backQueues[owner->second];
+            size_t bytes = SpillQueue::itemBytes(item);
+            if (back.urls.size() < kBackQueueItems)
+            {
+                // Host already has a slot; keep its URLs together there
+                backBytes += bytes;
+                back.urls.push_back(std::move(item));
+            }
+            else if (memoryCeiling == 0 || memoryBytes() + bytes <= memoryCeiling)
+            {
+                backBytes += bytes;
+                back.parked.push_back(std::move(item));
+            }
+            else
+            {
+                // No room to park it either. Putting it back at the tail would
+                // cycle it through the spill files, so leave it at the head and
+                // stop until the host has worked some of its URLs off.
+                frontQueues[frontQueueFor(item)].unpop(std::move(item));
+                break;
+            }
+            continue;
+        }
+
+        BackQueue &back = backQueues[queue];
+        backBytes += SpillQueue::itemBytes(item);
+        back.urls.push_back(std::move(item));
+        hostToBackQueue[host] = queue;
+        readyHeap.push(ReadyEntry{hostNextAllowed[host], queue});
+        back.host = host;
+        return;
+    }
+    freeBackQueues.push_back(queue);
+}
+
+void UrlFrontier::push(std::pair<std::string, int> item)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    pushFront(std::move(item));
+
+    if (!freeBackQueues.empty())
+    {
+        size_t queue = freeBackQueues.back();
+        freeBackQueues.pop_back();
+        refill(queue);
+    }
+}
+
+void UrlFrontier::push_batch(std::vector<std::pair<std::string, int>> &items)
+{
+    if (items.empty())
+        return;
+    static std::atomic<size_t> nextInbox{0};
+    thread_local size_t inbox = nextInbox++ % kInboxes;
+    size_t added = items.size();
+    {
+        std::lock_guard<std::mutex> lock(inboxes[inbox].mutex);
+        auto &queued = inboxes[inbox].items;
+        if (queued.empty())
+            queued.swap(items);
+        else
+            queued.insert(queued.end(), std::make_move_iterator(items.begin()), std::make_move_iterator(items.end()));
+        inboxCount += added;
+    }
+    items.clear();
+}
+
+void UrlFrontier::drainInboxes()
+{
+    if (inboxCount == 0)
+        return;
+    std::vector<Item> taken;
+    for (auto &inbox : inboxes)
+    {
+        {
+            std::lock_guard<std::mutex> lock(inbox.mutex);
+            taken.swap(inbox.items);
+            inboxCount -= taken.size();
+        }
+        for (auto &item : taken)
+        {
+            pushFront(std::move(item));
+        }
+        taken.clear();
+    }
+    fillFreeBackQueues();
+}
+
+void UrlFrontier::fillFreeBackQueues()
+{
+    while (!freeBackQueues.empty())
+    {
+        size_t queue = freeBackQueues.back();
+        freeBackQueues.pop_back();
+        refill(queue);
+        if (!freeBackQueues.empty() && freeBackQueues.back() == queue)
+            break; // Front queues ran dry and the slot went straight back
+    }
+}
+
+bool UrlFrontier::try_pop(std::pair<std::string, int> &item)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    drainInboxes();
+    Clock::time_point now = Clock::now();
+    if (readyHeap.empty() || readyHeap.top().due > now)
+    {
+        return false;
+    }
+
+    size_t queue = readyHeap.top().queue;
+    readyHeap.pop();
+    BackQueue &back = backQueues[queue];
+    backBytes -= SpillQueue::itemBytes(back.urls.front());
+    item = std::move(back.urls.front());
+    back.urls.pop_front();
+    count--;
+    if (!back.parked.empty())
+    {
+        back.urls.push_back(std::move(back.parked.front()));
+        back.parked.pop_front();
+    }
+    if (dispatched.emplace(item.first, item.second).second)
+        dispatchedBytes += SpillQueue::itemBytes(item) + kMapNodeBytes;
+
+    // The slot is reserved at dispatch, so the next URL for this host waits a full delay
+    Clock::time_point nextAllowed = now + hostDelay;
+    hostNextAllowed[back.host] = nextAllowed;
+    if (hostNextAllowed.size() >= hostSweepAt)
+        expireHosts(now);
+    if (!back.urls.empty())
+    {
+        readyHeap.push(ReadyEntry{nextAllowed, queue});
+    }
+    else
+    {
+        hostToBackQueue.erase(back.host);
+        refill(queue);
+    }
+    return true;
+}
+
+void UrlFrontier::expireHosts(Clock::time_point now)
+{
+    // A missing deadline reads as due, so only hosts outside their delay can
+    // go; hosts with a back queue keep theirs for the next refill
+    for (auto it = hostNextAllowed.begin(); it != hostNextAllowed.end();)
+    {
+        if (it->second <= now && hostToBackQueue.find(it->first) == hostToBackQueue.end())
+            it = hostNextAllowed.erase(it);
+        else
+            ++it;
+    }
+    hostSweepAt = std::max(kMinHostSweep, hostNextAllowed.size() * 2);
+}
+
+bool UrlFrontier::empty() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count == 0 && inboxCount == 0;
+}
+
+size_t UrlFrontier::size() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return count + inboxCount;
+}
+
+std::chrono::steady_clock::time_point UrlFrontier::nextDue() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (inboxCount > 0)
+        return Clock::now(); // try_pop has batches to place first
+    return readyHeap.empty() ? Clock::time_point::max() : readyHeap.top().due;
+}
+
+SpillStats UrlFrontier::spillStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    SpillStats total;
+    for (const auto &queue : frontQueues)
+    {
+        const SpillStats &s = queue.spillStats();
+        total.spilledItems += s.spilledItems;
+        total.spilledBytes += s.spilledBytes;
+        total.spillSeconds += s.spillSeconds;
+        total.refilledItems += s.refilledItems;
+        total.refilledBytes += s.refilledBytes;
+        total.refillSeconds += s.refillSeconds;
+    }
+    return total;
+}
+
+void UrlFrontier::complete(const std::string &url)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto it = dispatched.find(url);
+    if (it == dispatched.end())
+        return;
+    dispatchedBytes -= sizeof(Item) + it->first.size() + kMapNodeBytes;
+    dispatched.erase(it);
+}
+
+void UrlFrontier::snapshot(std::vector<Item> &items,
+                           std::vector<std::pair<uint64_t, std::chrono::system_clock::time_point>> &hostDeadlines,
+                           const std::string &spillLinkPrefix, std::vector<SpillRange> &spilled)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    items.reserve(items.size() + inboxCount + dispatched.size());
+    items.insert(items.end(), dispatched.begin(), dispatched.end());
+    for (auto &inbox : inboxes)
+    {
+        std::lock_guard<std::mutex> inboxLock(inbox.mutex);
+        items.insert(items.end(), inbox.items.begin(), inbox.items.end());
+    }
+    for (const auto &back : backQueues)
+    {
+        items.insert(items.end(), back.urls.begin(), back.urls.end());
+        items.insert(items.end(), back.parked.begin(), back.parked.end());
+    }
+    for (size_t i = 0; i < frontQueues.size(); ++i)
+    {
+        frontQueues[i].snapshot(items, spillLinkPrefix + "_" + std::to_string(i), spilled);
+    }
+
+    Clock::time_point now = Clock::now();
+    auto wallNow = std::chrono::system_clock::now();
+    for (const auto &entry : hostNextAllowed)
+    {
+        if (entry.second > now)
+        {
+            auto remaining = std::chrono::duration_cast<std::chrono::system_clock::duration>(entry.second - now);
+            hostDeadlines.emplace_back(entry.first, wallNow + remaining);
+        }
+    }
+}
+
+void UrlFrontier::restoreHost(uint64_t host, std::chrono::system_clock::time_point deadline)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto remaining = deadline - std::chrono::system_clock::now();
+    if (remaining > std::chrono::system_clock::duration::zero())
+    {
+        hostNextAllowed[host] = Clock::now() + std::chrono::duration_cast<Clock::duration>(remaining);
+    }
+}
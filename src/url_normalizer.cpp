@@ -0,0 +1,335 @@
+#include "url_normalizer.h"
+#include <string_view>
+
+struct UrlParts
+{
+    std::string_view scheme;
+    std::string_view authority;
+    std::string_view path;
+    std::string_view query;
+    bool hasScheme = false;
+    bool hasAuthority = false;
+    bool hasQuery = false;
+};
+
+static const char kHex[] = "0123456789ABCDEF";
+
+static bool isAlpha(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+}
+
+static bool isDigit(char c)
+{
+    return c >= '0' && c <= '9';
+}
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    return -1;
+}
+
+static char toLower(char c)
+{
+    return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+static bool isUnreserved(unsigned char c)
+{
+    return isAlpha(static_cast<char>(c)) || isDigit(static_cast<char>(c)) || c == '-' || c == '.' || c == '_' || c == '~';
+}
+
+// Bytes that are never valid raw in a path or query
+static bool mustEncode(unsigned char c)
+{
+    return c <= 0x20 || c >= 0x7F || c == '"' || c == '<' || c == '>' || c == '\\' || c == '^' || c == '`' ||
+           c == '{' || c == '|' || c == '}';
+}
+
+static bool equalsIgnoreCase(std::string_view a, const char *b)
+{
+    size_t i = 0;
+    for (; i < a.size() && b[i]; ++i)
+    {
+        if (toLower(a[i]) != b[i])
+            return false;
+    }
+    return i == a.size() && !b[i];
+}
+
+static std::string_view trim(std::string_view text)
+{
+    size_t begin = 0;
+    size_t end = text.size();
+    while (begin < end && static_cast<unsigned char>(text[begin]) <= 0x20)
+        begin++;
+    while (end > begin && static_cast<unsigned char>(text[end - 1]) <= 0x20)
+        end--;
+    return text.substr(begin, end - begin);
+}
+
+static void parse(std::string_view text, UrlParts &parts)
+{
+    size_t i = 0;
+    if (!text.empty() && isAlpha(text[0]))
+    {
+        size_t j = 1;
+        while (j < text.size() && (isAlpha(text[j]) || isDigit(text[j]) || text[j] == '+' || text[j] == '-' || text[j] == '.'))
+            j++;
+        if (j < text.size() && text[j] == ':')
+        {
+            parts.scheme = text.substr(0, j);
+            parts.hasScheme = true;
+            i = j + 1;
+        }
+    }
+
+    if (text.compare(i, 2, "//") == 0)
+    {
+        size_t end = text.find_first_of("/?#", i + 2);
+        if (end == std::string_view::npos)
+            end = text.size();
+        parts.authority = text.substr(i + 2, end - i - 2);
+        parts.hasAuthority = true;
+        i = end;
+    }
+
+    size_t end = text.find_first_of("?#", i);
+    if (end == std::string_view::npos)
+        end = text.size();
+    parts.path = text.substr(i, end - i);
+    i = end;
+
+    if (i < text.size() && text[i] == '?')
+    {
+        end = text.find('#', i + 1);
+        if (end == std::string_view::npos)
+            end = text.size();
+        parts.query = text.substr(i + 1, end - i - 1);
+        parts.hasQuery = true;
+    }
+}
+
+// Uppercases escapes, decodes escaped unreserved characters and escapes
+// bytes that may not appear raw. Tabs and newlines are dropped like browsers do.
+static void appendPercentNormalized(std::string &out, std::string_view text)
+{
+    for (size_t i = 0; i < text.size(); ++i)
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c == '%')
+        {
+            int high = i + 2 < text.size() ? hexValue(text[i + 1]) : -1;
+            int low = high >= 0 ? hexValue(text[i + 2]) : -1;
+            if (low < 0)
+            {
+                out += "%25";
+                continue;
+            }
+            unsigned char decoded = static_cast<unsigned char>(high * 16 + low);
+            if (isUnreserved(decoded))
+            {
+                out += static_cast<char>(decoded);
+            }
+            else
+            {
+                out += '%';
+                out += kHex[high];
+                out += kHex[low];
+            }
+            i += 2;
+        }
+        else if (c == '\t' || c == '\n' || c == '\r')
+        {
+            continue;
+        }
+        else if (mustEncode(c))
+        {
+            out += '%';
+            out += kHex[c >> 4];
+            out += kHex[c & 15];
+        }
+        else
+        {
+            out += static_cast<char>(c);
+        }
+    }
+}
+
+// RFC 3986 section 5.2.4 for an absolute path, appended to out
+static void appendWithoutDotSegments(std::string &out, std::string_view path)
+{
+    size_t base = out.size();
+    size_t i = path.empty() || path[0] != '/' ? 0 : 1;
+    while (i <= path.size())
+    {
+        size_t end = path.find('/', i);
+        bool last = end == std::string_view::npos;
+        if (last)
+            end = path.size();
+        std::string_view segment = path.substr(i, end - i);
+
+        if (segment == "..")
+        {
+            size_t slash = out.rfind('/');
+            out.resize(slash == std::string::npos || slash < base ? base : slash);
+            if (last)
+                out += '/';
+        }
+        else if (segment == ".")
+        {
+            if (last)
+                out += '/';
+        }
+        else
+        {
+            out += '/';
+            out += segment;
+        }
+        i = end + 1;
+    }
+    if (out.size() == base)
+        out += '/';
+}
+
+static bool appendAuthority(std::string &out, std::string_view authority, bool https)
+{
+    size_t at = authority.rfind('@');
+    if (at != std::string_view::npos)
+    {
+        out.append(authority.data(), at + 1);
+        authority.remove_prefix(at + 1);
+    }
+
+    // A port follows the last colon unless it sits inside an IPv6 literal
+    size_t colon = authority.rfind(':');
+    size_t bracket = authority.rfind(']');
+    std::string_view host = authority;
+    std::string_view port;
+    if (colon != std::string_view::npos && (bracket == std::string_view::npos || colon > bracket))
+    {
+        host = authority.substr(0, colon);
+        port = authority.substr(colon + 1);
+    }
+    if (host.empty())
+        return false;
+
+    size_t hostStart = out.size();
+    appendPercentNormalized(out, host);
+    for (size_t i = hostStart; i < out.size(); ++i)
+    {
+        if (out[i] == '%')
+            i += 2; // the hex digits of an escape stay uppercase, as everywhere else
+        else
+            out[i] = toLower(out[i]);
+    }
+    while (out.size() > hostStart + 1 && out.back() == '.')
+        out.pop_back(); // "example.com." names the same host
+
+    size_t first = port.find_first_not_of('0');
+    std::string_view digits = first == std::string_view::npos ? std::string_view() : port.substr(first);
+    if (!port.empty() && digits != (https ? "443" : "80"))
+    {
+        for (char c : port)
+        {
+            if (!isDigit(c))
+                return false;
+        }
+        out += ':';
+        out += digits.empty() ? std::string_view("0") : digits;
+    }
+    return true;
+}
+
+static std::string compose(const UrlParts &parts, std::string_view mergeBase, std::string_view mergePath)
+{
+    bool https = equalsIgnoreCase(parts.scheme, "https");
+    if (!https && !equalsIgnoreCase(parts.scheme, "http"))
+        return "";
+    if (!parts.hasAuthority)
+        return "";
+
+    std::string out;
+    out.reserve(parts.scheme.size() + parts.authority.size() + mergeBase.size() + parts.path.size() + parts.query.size() + 8);
+    out += https ? "https://" : "http://";
+    if (!appendAuthority(out, parts.authority, https))
+        return "";
+
+    // Escapes are normalized first so that %2E segments are seen as dots
+    thread_local std::string path;
+    path.clear();
+    appendPercentNormalized(path, mergeBase);
+    appendPercentNormalized(path, mergePath.empty() ? parts.path : mergePath);
+    appendWithoutDotSegments(out, path);
+
+    if (parts.hasQuery)
+    {
+        out += '?';
+        appendPercentNormalized(out, parts.query);
+    }
+    return out;
+}
+
+std::string resolveUrl(const std::string &base, const std::string &reference)
+{
+    UrlParts ref;
+    parse(trim(reference), ref);
+    if (ref.hasScheme)
+    {
+        return compose(ref, std::string_view(), std::string_view());
+    }
+
+    UrlParts target;
+    parse(base, target);
+    if (!target.hasScheme || !target.hasAuthority)
+        return "";
+
+    if (ref.hasAuthority)
+    {
+        // Protocol-relative: only the scheme comes from the base
+        target.authority = ref.authority;
+        target.path = ref.path;
+        target.query = ref.query;
+        target.hasQuery = ref.hasQuery;
+        return compose(target, std::string_view(), std::string_view());
+    }
+
+    if (ref.path.empty())
+    {
+        // Same document, or a new query on it
+        if (ref.hasQuery)
+        {
+            target.query = ref.query;
+            target.hasQuery = true;
+        }
+        return compose(target, std::string_view(), std::string_view());
+    }
+
+    target.query = ref.query;
+    target.hasQuery = ref.hasQuery;
+    if (ref.path[0] == '/')
+    {
+        target.path = ref.path;
+        return compose(target, std::string_view(), std::string_view());
+    }
+
+    // Merge: keep the base path up to its last slash and append the reference
+    size_t slash = target.path.rfind('/');
+    std::string_view directory = slash == std::string_view::npos ? std::string_view("/") : target.path.substr(0, slash + 1);
+    return compose(target, directory, ref.path);
+}
+
+std::string normalizeUrl(const std::string &url)
+{
+    UrlParts parts;
+    parse(trim(url), parts);
+    if (!parts.hasScheme)
+        return "";
+    return compose(parts, std::string_view(), std::string_view());
+}
@@ -0,0 +1,62 @@
+#include "url_view.h"
+#include "fingerprint.h"
+
+UrlView::UrlView(std::string_view url)
+    : text(url)
+{
+    size_t n = text.size();
+    size_t i = 0;
+    while (i < n && text[i] != ':')
+    {
+        if (text[i] == '/' || text[i] == '?' || text[i] == '#')
+            return;
+        i++;
+    }
+    if (i == 0 || i + 2 >= n || text[i + 1] != '/' || text[i + 2] != '/')
+        return;
+    schemeEnd = static_cast<uint32_t>(i);
+
+    // Userinfo ends at the last '@'; the port follows the last colon outside an IPv6 literal
+    i += 3;
+    size_t begin = i;
+    size_t colon = std::string_view::npos;
+    for (; i < n; ++i)
+    {
+        char c = text[i];
+        if (c == '/' || c == '?' || c == '#')
+            break;
+        if (c == '@')
+        {
+            begin = i + 1;
+            colon = std::string_view::npos;
+        }
+        else if (c == ':')
+        {
+            colon = i;
+        }
+        else if (c == ']')
+        {
+            colon = std::string_view::npos;
+        }
+    }
+    hostBegin = static_cast<uint32_t>(begin);
+    hostEnd = static_cast<uint32_t>(colon != std::string_view::npos ? colon : i);
+    portEnd = static_cast<uint32_t>(i);
+
+    while (i < n && text[i] != '?' && text[i] != '#')
+        i++;
+    pathEnd = static_cast<uint32_t>(i);
+    if (i < n && text[i] == '?')
+    {
+        while (i < n && text[i] != '#')
+            i++;
+    }
+    queryEnd = static_cast<uint32_t>(i);
+    parsed = hostEnd > hostBegin;
+}
+
+uint64_t UrlView::hostKey() const
+{
+    std::string_view name = host();
+    return fingerprint128(name.data(), name.size()).lo;
+}
@@ -0,0 +1,276 @@
+#include "visited_set.h"
+#include <algorithm>
+#include <functional>
+#include <cstdint>
+#include <cmath>
+#include <filesystem>
+
+VisitedSet::VisitedSet(size_t shardCount, VisitedMode visitedMode, size_t expectedUrls, double falsePositiveRate,
+                       const std::string &stateDir)
+    : shardBits(0), mode(visitedMode)
+{
+    while ((size_t(1) << shardBits) < shardCount)
+        shardBits++;
+    size_t count = size_t(1) << shardBits;
+    shards.reset(new Shard[count]);
+
+    if (mode == VisitedMode::Bloom)
+    {
+        std::filesystem::create_directories(stateDir);
+        size_t perShard = expectedUrls / count + 1;
+        for (size_t i = 0; i < count; ++i)
+        {
+            shards[i].bloom = std::make_unique<BlockedBloomFilter>(perShard, falsePositiveRate);
+            shards[i].disk = std::make_unique<DiskFingerprintStore>(stateDir + "/visited_" + std::to_string(i));
+        }
+    }
+}
+
+size_t VisitedSet::shardFor(uint64_t hash) const
+{
+    // Tables bucket on the low bits, so pick the shard from the high bits of a remix
+    if (shardBits == 0)
+        return 0;
+    uint64_t mixed = hash * 0x9E3779B97F4A7C15ull;
+    return static_cast<size_t>(mixed >> (64 - shardBits));
+}
+
+VisitedSet::Key VisitedSet::keyFor(const std::string &url) const
+{
+    Key key{};
+    if (mode == VisitedMode::Strings)
+    {
+        key.shard = shardFor(std::hash<std::string>{}(url));
+    }
+    else
+    {
+        key.fingerprint = fingerprint128(url);
+        if (mode == VisitedMode::Fingerprint64)
+            key.fingerprint.hi = 0;
+        key.shard = shardFor(key.fingerprint.lo);
+    }
+    return key;
+}
+
+bool VisitedSet::insertLocked(Shard &shard, const std::string &url, const Key &key)
+{
+    switch (mode)
+    {
+    case VisitedMode::Fingerprint64:
+        return shard.fingerprints64.insert(key.fingerprint.lo);
+    case VisitedMode::Fingerprint128:
+        return shard.fingerprints128.insert(key.fingerprint);
+    case VisitedMode::Bloom:
+        if (!shard.bloom->testAndSet(key.fingerprint))
+        {
+            // A Bloom negative is definite, so there is nothing to look up:
+            // the key is buffered and reaches disk in the next sequential run
+            shard.disk->add(key.fingerprint);
+            return true;
+        }
+        shard.bloomPositives++;
+        if (shard.disk->insert(key.fingerprint))
+        {
+            shard.bloomFalsePositives++;
+            return true;
+        }
+        return false;
+    default:
+        return shard.urls.insert(url).second;
+    }
+}
+
+bool VisitedSet::insert(const std::string &url)
+{
+    Key key = keyFor(url);
+    Shard &shard = shards[key.shard];
+    bool added;
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        added = insertLocked(shard, url, key);
+    }
+    flushIfDue(shard);
+    return added;
+}
+
+void VisitedSet::flushIfDue(Shard &shard)
+{
+    // Runs after the shard lock is dropped, so inserts into this shard are not held up
+    if (mode == VisitedMode::Bloom && shard.disk->flushDue())
+        shard.disk->flush();
+}
+
+std::vector<bool> VisitedSet::insert_batch(const std::vector<std::string> &urls)
+{
+    std::vector<bool> added(urls.size(), false);
+    std::vector<std::pair<Key, size_t>> order;
+    order.reserve(urls.size());
+    for (size_t i = 0; i < urls.size(); ++i)
+    {
+        order.emplace_back(keyFor(urls[i]), i);
+    }
+    std::sort(order.begin(), order.end(), [](const auto &a, const auto &b) { return a.first.shard < b.first.shard; });
+
+    size_t i = 0;
+    while (i < order.size())
+    {
+        size_t current = order[i].first.shard;
+        Shard &shard = shards[current];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            for (; i < order.size() && order[i].first.shard == current; ++i)
+            {
+                added[order[i].second] = insertLocked(shard, urls[order[i].second], order[i].first);
+            }
+        }
+        flushIfDue(shard);
+    }
+    return added;
+}
+
+bool VisitedSet::contains(const std::string &url) const
+{
+    Key key = keyFor(url);
+    Shard &shard = shards[key.shard];
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    switch (mode)
+    {
+    case VisitedMode::Fingerprint64:
+        return shard.fingerprints64.contains(key.fingerprint.lo);
+    case VisitedMode::Fingerprint128:
+        return shard.fingerprints128.contains(key.fingerprint);
+    case VisitedMode::Bloom:
+        return shard.bloom->mayContain(key.fingerprint) && shard.disk->contains(key.fingerprint);
+    default:
+        return shard.urls.count(url) > 0;
+    }
+}
+
+size_t VisitedSet::size() const
+{
+    return stats().urls;
+}
+
+VisitedStats VisitedSet::stats() const
+{
+    VisitedStats s;
+    for (size_t i = 0; i < (size_t(1) << shardBits); ++i)
+    {
+        Shard &shard = shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        switch (mode)
+        {
+        case VisitedMode::Fingerprint64:
+            s.urls += shard.fingerprints64.size();
+            s.memoryBytes += shard.fingerprints64.memoryBytes();
+            break;
+        case VisitedMode::Fingerprint128:
+            s.urls += shard.fingerprints128.size();
+            s.memoryBytes += shard.fingerprints128.memoryBytes();
+            break;
+        case VisitedMode::Bloom:
+            s.urls += shard.disk->size();
+            s.memoryBytes += shard.bloom->memoryBytes() + shard.disk->memoryBytes();
+            s.diskBytes += shard.disk->diskBytes();
+            s.bloomPositives += shard.bloomPositives;
+            s.bloomFalsePositives += shard.bloomFalsePositives;
+            break;
+        default:
+            // Approximate libstdc++ node layout: next pointer, string, cached hash,
+            // plus the bucket array and a heap buffer for strings past the SSO limit
+            s.urls += shard.urls.size();
+            s.memoryBytes += shard.urls.bucket_count() * sizeof(void *);
+            for (const auto &url : shard.urls)
+            {
+                s.memoryBytes += sizeof(void *) + sizeof(std::string) + sizeof(size_t) + 16;
+                if (url.capacity() > 15)
+                    s.memoryBytes += url.capacity() + 1 + 16;
+            }
+            break;
+        }
+    }
+
+    if (mode == VisitedMode::Fingerprint64 || mode == VisitedMode::Fingerprint128)
+    {
+        double bits = mode == VisitedMode::Fingerprint64 ? 64 : 128;
+        double n = static_cast<double>(s.urls);
+        s.expectedCollisions = n * (n - 1) / 2 / std::pow(2.0, bits);
+    }
+    return s;
+}
+
+size_t VisitedSet::save(CheckpointWriter &writer) const
+{
+    std::string &out = writer.out();
+    size_t saved = 0;
+    for (size_t i = 0; i < (size_t(1) << shardBits); ++i)
+    {
+        Shard &shard = shards[i];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        switch (mode)
+        {
+        case VisitedMode::Fingerprint64:
+            shard.fingerprints64.forEach([&](uint64_t key) {
+                appendU64(out, key);
+                writer.endRecord();
+            });
+            saved += shard.fingerprints64.size();
+            break;
+        case VisitedMode::Fingerprint128:
+            shard.fingerprints128.forEach([&](const Fingerprint128 &key) {
+                appendU64(out, key.lo);
+                appendU64(out, key.hi);
+                writer.endRecord();
+            });
+            saved += shard.fingerprints128.size();
+            break;
+        case VisitedMode::Bloom:
+            // The store file keeps changing after the snapshot, so its keys are copied out
+            shard.disk->forEach([&](const Fingerprint128 &key) {
+                appendU64(out, key.lo);
+                appendU64(out, key.hi);
+                writer.endRecord();
+            });
+            saved += shard.disk->size();
+            break;
+        default:
+            for (const auto &url : shard.urls)
+            {
+                appendBytes(out, url);
+                writer.endRecord();
+            }
+            saved += shard.urls.size();
+            break;
+        }
+    }
+    return saved;
+}
+
+bool VisitedSet::load(CheckpointCursor cursor, size_t count)
+{
+    std::string url;
+    for (size_t i = 0; i < count; ++i)
+    {
+        Key key{};
+        if (mode == VisitedMode::Strings)
+        {
+            if (!cursor.getBytes(url))
+                return false;
+            insert(url);
+            continue;
+        }
+
+        if (!cursor.getU64(key.fingerprint.lo))
+            return false;
+        if (mode != VisitedMode::Fingerprint64 && !cursor.getU64(key.fingerprint.hi))
+            return false;
+        key.shard = shardFor(key.fingerprint.lo);
+        Shard &shard = shards[key.shard];
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            insertLocked(shard, url, key);
+        }
+        flushIfDue(shard);
+    }
+    return true;
+}
@@ -1,256 +1,465 @@
 #include "web_crawler.h"
-#include "utils.h"
+#include "url_normalizer.h"
+#include "page_extractors.h"
+#include "link_scanner.h"
+#include "parse_arena.h"
 #include <iostream>
 #include <curl/curl.h>
 #include <gumbo.h>
 #include "json.hpp"
 #include <filesystem>
-#include "thread_safe_queue.h"
 #include "finalize_json.h"
 using namespace std::chrono_literals;
 using json = nlohmann::json;
 namespace fs = std::filesystem;
 
-size_t WebCrawler::WriteCallback(void *contents, size_t size, size_t nmemb, std::string *userp)
+PageMetadata WebCrawler::extractMetadata(const std::string &html, const std::string &url, int depth)
 {
-    userp->append(static_cast<char *>(contents), size * nmemb);
-    return size * nmemb;
+    PageMetadata metadata;
+    metadata.url = url;
+    metadata.depth = depth;
+
+    // Scan mode never gets here: the fetch engines scan bodies as they arrive
+    auto start = std::chrono::steady_clock::now();
+    extractPage(html, metadata, parseArena ? &ParseArena::local() : nullptr);
+    auto parsed = std::chrono::steady_clock::now();
+    domNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(parsed - start).count();
+    domBytes += html.size();
+
+    if (extractMode == ExtractMode::Compare)
+    {
+        // Gumbo's result is the one used; the scanner's is only checked against it
+        PageMetadata scanned;
+        scanned.url = url;
+        scanned.depth = depth;
+        scanPage(html, scanned);
+        scanNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - parsed).count();
+        scanBytes += html.size();
+
+        std::string differences;
+        auto differ = [&differences](bool same, const char *field) {
+            if (!same)
+                differences += differences.empty() ? field : std::string(", ") + field;
+        };
+        differ(scanned.title == metadata.title, "title");
+        differ(scanned.description == metadata.description, "description");
+        differ(scanned.links == metadata.links, "links");
+        differ(scanned.canonical == metadata.canonical, "canonical");
+        differ(scanned.noindex == metadata.noindex && scanned.nofollow == metadata.nofollow, "robots");
+        differ(scanned.nofollowLinks == metadata.nofollowLinks, "nofollow links");
+        comparedPages++;
+        if (!differences.empty() && mismatchedPages++ < 10)
+        {
+            std::cerr << "Link scanner differs from Gumbo on " << url << ": " << differences << std::endl;
+        }
+    }
+    return metadata;
 }
 
-std::vector<std::string> WebCrawler::extractLinks(const std::string &html, const std::string &baseUrl)
+void WebCrawler::processUrl(const std::string &url, int depth, int threadId)
 {
-    std::vector<std::string> links;
-    GumboOutput *output = gumbo_parse(html.c_str());
-    extractLinksHelper(output->root, links, baseUrl);
-    gumbo_destroy_output(&kGumboDefaultOptions, output);
-    return links;
+    // Hand the transfer to an event loop; the worker is free as soon as it is queued
+    fetchEngines[threadId % fetchEngines.size()]->submit(FetchRequest{url, depth});
 }
 
-void WebCrawler::extractLinksHelper(GumboNode *node, std::vector<std::string> &links, const std::string &baseUrl)
+void WebCrawler::processResult(FetchResult &result, int threadId)
 {
-    // Implementation
-    if (node->type != GUMBO_NODE_ELEMENT)
+    if (result.status != CURLE_OK)
     {
+        retire(result.url);
         return;
     }
 
-    if (node->v.element.tag == GUMBO_TAG_A)
+    // A redirected page is handled under the URL it ended up at
+    std::string pageUrl = result.url;
+    std::vector<std::string> redirectedFrom;
+    LinkBatch *hops = claimRedirects(result, pageUrl, redirectedFrom);
+    if (pageUrl.empty())
     {
-        GumboAttribute *href = gumbo_get_attribute(&node->v.element.attributes, "href");
-        if (href)
-        {
-            std::string url = href->value;
-            if (!url.empty() && url[0] != '#')
-            {
-                if (url.find("http") != 0)
-                {
-                    url = baseUrl + (url[0] == '/' ? "" : "/") + url;
-                }
-                links.push_back(url);
-            }
-        }
+        redirectDuplicates++;
+        retireHops(hops);
+        retire(result.url);
+        return;
     }
 
-    GumboVector *children = &node->v.element.children;
-    for (unsigned int i = 0; i < children->length; ++i)
+    PageMetadata metadata;
+    if (result.scanned)
     {
-        extractLinksHelper(static_cast<GumboNode *>(children->data[i]), links, baseUrl);
+        metadata = std::move(result.metadata);
+        metadata.url = pageUrl;
+        metadata.depth = result.depth;
     }
-}
+    else
+    {
+        metadata = extractMetadata(result.body, pageUrl, result.depth);
+    }
+    metadata.redirectedFrom = std::move(redirectedFrom);
 
-PageMetadata WebCrawler::extractMetadata(const std::string &html, const std::string &url, int depth)
-{
-    // Implementation
-    PageMetadata metadata;
-    metadata.url = url;
-    metadata.depth = depth;
+    // Write metadata to thread-specific file, unless robots meta asks not to index the page
+    if (metadata.noindex)
+    {
+        noindexPages++;
+    }
+    else
+    {
+        json j;
+        j["url"] = metadata.url;
+        j["title"] = metadata.title;
+        j["description"] = metadata.description;
+        j["depth"] = metadata.depth;
+        j["links"] = metadata.links;
+        if (!metadata.canonical.empty())
+            j["canonical"] = metadata.canonical;
+        if (!metadata.redirectedFrom.empty())
+            j["redirected_from"] = metadata.redirectedFrom;
+
+        std::lock_guard<std::mutex> lock(filesMutex);
+        //my code
+        if (threadFileContainsJson[threadId])
+        {
+            threadFiles[threadId] << ",\n";  // Add a comma if it's not the first object
+        }
 
-    GumboOutput *output = gumbo_parse(html.c_str());
-    GumboNode *root = output->root;
+        threadFiles[threadId] << j.dump(4) << std::endl;
+        threadFiles[threadId].flush();
+        threadFileContainsJson[threadId] = true;
+    }
 
-    // Search for the title tag
-    GumboNode *title_node = nullptr;
-    GumboVector *head_children = &root->v.element.children;
-    for (unsigned int i = 0; i < head_children->length; ++i)
+    // Rewrite tracking and session parameters so spellings of one page collapse in dedup.
+    // The page was written out above with the links as it gives them.
+    std::vector<uint64_t> rewrites;
+    if (queryRules)
     {
-        GumboNode *child = static_cast<GumboNode *>(head_children->data[i]);
-        if (child->type == GUMBO_NODE_ELEMENT && child->v.element.tag == GUMBO_TAG_TITLE)
+        rewrites.resize(metadata.links.size());
+        for (size_t i = 0; i < metadata.links.size(); ++i)
         {
-            title_node = child;
-            break;
+            rewrites[i] = queryRules->apply(metadata.links[i]);
         }
     }
-
-    // Extract title text if the title tag is found
-    if (title_node && title_node->v.element.children.length > 0)
+    uint64_t canonicalRewrite = 0;
+    if (queryRules && !metadata.canonical.empty())
+        canonicalRewrite = queryRules->apply(metadata.canonical);
+
+    // Robots nofollow drops every link. A page that names another URL as
+    // canonical is a duplicate: when that URL is new it is queued instead of
+    // the page's links, which its own page will carry. When it is already
+    // known, nothing guarantees those links reach the crawl, so they are
+    // followed as usual.
+    LinkBatch *batch = nullptr;
+    int childDepth = result.depth + 1;
+    nofollowLinks += metadata.nofollowLinks;
+    if (metadata.nofollow)
     {
-        GumboNode *title_text = static_cast<GumboNode *>(title_node->v.element.children.data[0]);
-        metadata.title = title_text->v.text.text;
+        nofollowPages++;
+        metadata.links.clear();
+        rewrites.clear();
     }
-    else
+    else if (childDepth < maxDepth && !metadata.canonical.empty() && metadata.canonical != pageUrl)
     {
-        metadata.title = "No title";
+        std::vector<std::string> canonical(1, metadata.canonical);
+        int claim = openClaim();
+        std::vector<bool> added = visitedUrls.insert_batch(canonical);
+        std::vector<bool> accepted = traps ? traps->check(canonical, added) : added;
+        if (accepted[0])
+            batch = new LinkBatch(1, std::make_pair(metadata.canonical, childDepth));
+        closeClaim(claim, batch);
+        if (batch)
+        {
+            canonicalPages++;
+            metadata.links.clear();
+            rewrites.clear();
+        }
+        else if (!added[0] && canonicalRewrite)
+        {
+            queryRules->recordCollapsed(canonicalRewrite);
+        }
     }
 
-    // Extract meta description
-    metadata.description = "No description";
-    for (unsigned int i = 0; i < head_children->length; ++i)
+    // Collect new URLs into a batch on this worker's own deque
+    if (childDepth < maxDepth && !metadata.links.empty())
     {
-        GumboNode *child = static_cast<GumboNode *>(head_children->data[i]);
-        if (child->type == GUMBO_NODE_ELEMENT && child->v.element.tag == GUMBO_TAG_META)
+        // Only links this insert claimed go into the batch; a snapshot waits
+        // for the claim to close, so it never lists links that were already done
+        int claim = openClaim();
+        std::vector<bool> added = visitedUrls.insert_batch(metadata.links);
+        // Trap checks only see new URLs; a rejected one stays visited and is never queued
+        std::vector<bool> accepted = traps ? traps->check(metadata.links, added) : added;
+        batch = new LinkBatch();
+        for (size_t i = 0; i < added.size(); ++i)
         {
-            GumboAttribute *name = gumbo_get_attribute(&child->v.element.attributes, "name");
-            if (name && strcmp(name->value, "description") == 0)
-            {
-                GumboAttribute *content = gumbo_get_attribute(&child->v.element.attributes, "content");
-                if (content)
-                {
-                    metadata.description = content->value;
-                    break;
-                }
-            }
+            if (accepted[i])
+                batch->emplace_back(std::move(metadata.links[i]), childDepth);
+            else if (!added[i] && !rewrites.empty() && rewrites[i])
+                queryRules->recordCollapsed(rewrites[i]);
         }
+        if (batch->empty())
+        {
+            delete batch;
+            batch = nullptr;
+        }
+        closeClaim(claim, batch);
     }
 
-    // Extract links
-    metadata.links = extractLinks(html, url);
-
-    gumbo_destroy_output(&kGumboDefaultOptions, output);
-    return metadata;
+    // Children are counted before this page is retired so the total never dips to zero early
+    if (batch)
+    {
+        if (wal)
+            wal->appendBatch(WalRecord::Discovered, *batch);
+        pendingWork += batch->size();
+        linkDeques[threadId]->push(batch);
+    }
+    retireHops(hops);
+    retire(result.url);
 }
 
-void WebCrawler::processUrl(const std::string &url, int depth, int threadId)
+LinkBatch *WebCrawler::claimRedirects(const FetchResult &result, std::string &pageUrl,
+                                      std::vector<std::string> &redirectedFrom)
 {
-    // Implementation
-    if (depth >= maxDepth)
-        exit(0);
+    if (result.redirects.empty())
+        return nullptr;
+
+    // Rebuild the chain curl followed in the same canonical form links get
+    std::vector<std::string> chain;
+    std::string current = result.url;
+    for (const auto &location : result.redirects)
+    {
+        current = resolveUrl(current, location);
+        if (current.empty())
+            break;
+        chain.push_back(current);
+    }
+    std::string effective = normalizeUrl(result.effectiveUrl);
+    if (!effective.empty() && (chain.empty() || chain.back() != effective))
+        chain.push_back(effective);
+    if (chain.empty())
+        return nullptr;
+    if (queryRules)
+    {
+        for (auto &url : chain)
+            queryRules->apply(url);
+    }
 
-    // Implement rate limiting
-    std::string domain = getDomain(url);
-    std::chrono::steady_clock::time_point lastRequest;
+    // The last hop is the page. Every hop is claimed once, except the fetched
+    // URL, which is this page's already; a chain such as A -> B -> A lands there.
+    const std::string &landing = chain.back();
+    std::vector<std::string> claims;
+    for (const auto &url : chain)
+    {
+        if (url != result.url && std::find(claims.begin(), claims.end(), url) == claims.end())
+            claims.push_back(url);
+    }
+    redirectedFrom.push_back(result.url);
+    for (size_t i = 0; i + 1 < chain.size(); ++i)
     {
-        std::lock_guard<std::mutex> lock(visitedMutex);
-        auto it = domainLastRequest.find(domain);
-        if (it != domainLastRequest.end())
+        if (std::find(redirectedFrom.begin(), redirectedFrom.end(), chain[i]) == redirectedFrom.end())
+            redirectedFrom.push_back(chain[i]);
+    }
+    redirectedFrom.erase(std::remove(redirectedFrom.begin(), redirectedFrom.end(), landing), redirectedFrom.end());
+
+    // The claimed hops are published like a link batch, so a snapshot that sees
+    // them visited also lists them pending and a resumed crawl still expands the page
+    bool landed = landing == result.url;
+    LinkBatch *hops = nullptr;
+    if (!claims.empty())
+    {
+        int claim = openClaim();
+        std::vector<bool> added = visitedUrls.insert_batch(claims);
+        hops = new LinkBatch();
+        for (size_t i = 0; i < claims.size(); ++i)
         {
-            lastRequest = it->second;
+            if (!added[i])
+                continue;
+            hops->emplace_back(claims[i], result.depth);
+            landed = landed || claims[i] == landing;
         }
-        else
+        if (hops->empty())
         {
-            lastRequest = std::chrono::steady_clock::now();
-            domainLastRequest[domain] = lastRequest;
+            delete hops;
+            hops = nullptr;
         }
+        closeClaim(claim, hops);
+        if (hops && wal)
+            wal->appendBatch(WalRecord::Discovered, *hops);
     }
+    if (hops)
+        redirectHops += hops->size();
+    pageUrl = landed ? landing : std::string();
+    return hops;
+}
 
-    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
-    std::chrono::milliseconds delayRemaining = domainDelay - std::chrono::duration_cast<std::chrono::milliseconds>(now - lastRequest);
-    if (delayRemaining.count() > 0)
+int WebCrawler::openClaim()
+{
+    std::lock_guard<std::mutex> lock(batchMutex);
+    int side = static_cast<int>(claimEpoch & 1);
+    openClaims[side]++;
+    return side;
+}
+
+void WebCrawler::closeClaim(int side, LinkBatch *batch)
+{
+    bool last;
     {
-        std::this_thread::sleep_for(delayRemaining);
+        std::lock_guard<std::mutex> lock(batchMutex);
+        if (batch)
+            liveBatches.insert(batch);
+        last = --openClaims[side] == 0;
     }
+    if (last)
+        claimsClosed.notify_all();
+}
 
-    CURL *curl = curl_easy_init();
-    if (!curl)
+void WebCrawler::retireHops(LinkBatch *hops)
+{
+    if (!hops)
         return;
-
-    std::string response_string;
-    curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-    curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, WriteCallback);
-    curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
-    curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    curl_easy_setopt(curl, CURLOPT_TIMEOUT, 10L);
-
-    CURLcode res = curl_easy_perform(curl);
-    if (res == CURLE_OK)
     {
-        PageMetadata metadata = extractMetadata(response_string, url, depth);
-
-        // Write metadata to thread-specific file
-        json j;
-        j["url"] = metadata.url;
-        j["title"] = metadata.title;
-        j["description"] = metadata.description;
-        j["depth"] = metadata.depth;
-        j["links"] = metadata.links;
-
-        {
-            std::lock_guard<std::mutex> lock(filesMutex);
-            //my code
-            if (threadFileContainsJson[threadId])
-            {
-                threadFiles[threadId] << ",\n";  // Add a comma if it's not the first object
-            }
+        std::lock_guard<std::mutex> lock(batchMutex);
+        liveBatches.erase(hops);
+    }
+    // Like the page itself, the hops are done only after its links were logged
+    if (wal)
+        wal->appendBatch(WalRecord::Done, *hops);
+    delete hops;
+}
 
-            threadFiles[threadId] << j.dump(4) << std::endl;
-            threadFiles[threadId].flush();
-            threadFileContainsJson[threadId] = true;
-        }
+void WebCrawler::retire(const std::string &url)
+{
+    urlQueue.complete(url);
+    // Logged after the page's links, so replay never drops a page whose children were lost
+    if (wal)
+        wal->append(WalRecord::Done, url);
+    finishWork();
+}
 
-        // Add new URLs to queue
-        for (const auto &link : metadata.links)
+void WebCrawler::finishWork(long count)
+{
+    if (pendingWork.fetch_sub(count) == count)
+    {
         {
-            bool shouldAdd = false;
-            {
-                std::lock_guard<std::mutex> lock(visitedMutex);
-                if (visitedUrls.find(link) == visitedUrls.end())
-                {
-                    visitedUrls.insert(link);
-                    shouldAdd = true;
-                }
-            }
-            if (shouldAdd)
-            {
-                urlQueue.push(make_pair(link, depth + 1));
-            }
+            std::lock_guard<std::mutex> lock(doneMutex);
+            shouldStop = true;
         }
+        doneCond.notify_all();
+        completedFetches.cancel();
     }
+}
 
-    curl_easy_cleanup(curl);
+bool WebCrawler::takeLinks(int threadId, LinkBatch *&batch)
+{
+    if (linkDeques[threadId]->pop(batch))
+        return true;
 
-    // Update last request time for the domain
+    // Own deque is dry: steal the oldest batch from another worker
+    for (int i = 1; i < numThreads; i++)
     {
-        std::lock_guard<std::mutex> lock(visitedMutex);
-        domainLastRequest[domain] = std::chrono::steady_clock::now();
+        if (linkDeques[(threadId + i) % numThreads]->steal(batch))
+            return true;
     }
+    return false;
 }
 
 void WebCrawler::workerThread(int threadId)
 {
-
-    // Implementation
-    activeThreads++;
     while (!shouldStop)
     {
-
+        FetchResult result;
+        LinkBatch *batch = nullptr;
         std::pair<std::string, int> urlWithDepth;
-        if (urlQueue.try_pop(urlWithDepth))
+        if (completedFetches.try_pop(result))
+        {
+            processResult(result, threadId);
+        }
+        else if (takeLinks(threadId, batch))
+        {
+            {
+                // Moving a batch into the frontier is atomic with respect to snapshots
+                std::lock_guard<std::mutex> lock(batchMutex);
+                urlQueue.push_batch(*batch);
+                liveBatches.erase(batch);
+            }
+            delete batch;
+        }
+        else if (urlQueue.try_pop(urlWithDepth))
         {
             processUrl(urlWithDepth.first, urlWithDepth.second, threadId);
         }
         else
         {
-            std::this_thread::sleep_for(100ms);
-            if (activeThreads == 1 && urlQueue.empty())
+            // Nothing runnable: block until a fetch completes or the next host becomes due
+            auto now = std::chrono::steady_clock::now();
+            auto due = urlQueue.nextDue();
+            std::chrono::milliseconds wait = 1000ms;
+            if (due - now < wait)
+                wait = std::max(0ms, std::chrono::duration_cast<std::chrono::milliseconds>(due - now) + 1ms);
+            if (completedFetches.wait_pop(result, wait))
             {
-                shouldStop = true;
+                processResult(result, threadId);
             }
         }
     }
-    activeThreads--;
 }
 
-WebCrawler::WebCrawler(int threads, int depth, int delayMs)
-    : maxDepth(depth), numThreads(threads), domainDelay(delayMs)
+static CrawlerOptions makeOptions(int threads, int depth, int delayMs, int fetchThreads, int maxInFlight)
+{
+    CrawlerOptions options;
+    options.threads = threads;
+    options.depth = depth;
+    options.delayMs = delayMs;
+    options.fetchThreads = fetchThreads;
+    options.maxInFlight = maxInFlight;
+    return options;
+}
+
+WebCrawler::WebCrawler(int threads, int depth, int delayMs, int fetchThreads, int maxInFlight)
+    : WebCrawler(makeOptions(threads, depth, delayMs, fetchThreads, maxInFlight))
 {
+}
+
+WebCrawler::WebCrawler(const CrawlerOptions &options)
+    : urlQueue(std::chrono::milliseconds(options.delayMs), options.depth,
+               static_cast<size_t>(std::max(1, options.fetchThreads)) * options.maxInFlight,
+               options.frontierMemoryBytes, options.stateDir),
+      visitedUrls(64, options.visitedMode, options.expectedUrls, options.bloomFalsePositiveRate, options.stateDir),
+      maxDepth(options.depth), numThreads(options.threads),
+      stateDir(options.stateDir),
+      checkpointPath(options.stateDir + "/checkpoint.bin"),
+      checkpointInterval(std::max(0, options.checkpointIntervalSec)),
+      walCommitInterval(std::max(1, options.walCommitMs)),
+      resume(options.resume),
+      extractMode(options.extractMode),
+      parseArena(options.parseArena)
+{
+    if (options.queryRules)
+    {
+        queryRules = std::make_unique<QueryRules>(options.queryRulesFile);
+    }
+    if (options.trapDetection)
+    {
+        traps = std::make_unique<TrapDetector>(options.trapLimits);
+    }
     curl_global_init(CURL_GLOBAL_ALL);
+    curlShare = std::make_unique<CurlShare>();
+    for (int i = 0; i < std::max(1, options.fetchThreads); i++)
+    {
+        fetchEngines.push_back(std::make_unique<FetchEngine>(completedFetches, curlShare.get(), options.maxInFlight,
+                                                             options.extractMode == ExtractMode::Scan,
+                                                             options.headOnlyBytes));
+    }
     fs::create_directory("crawler_output");
 
+    if (checkpointInterval.count() > 0 || resume)
+        fs::create_directories(options.stateDir);
+
     for (int i = 0; i < numThreads; i++)
     {
         std::string filename = "crawler_output/thread_" + std::to_string(i) + ".json";
-        threadFiles.emplace_back(filename);
-        threadFileContainsJson[i] = false;
+        // A resumed crawl keeps appending to the pages written before the restart
+        bool existing = resume && fs::exists(filename) && fs::file_size(filename) > 2;
+        threadFiles.emplace_back(filename, resume ? std::ios::app : std::ios::trunc);
+        threadFileContainsJson[i] = existing;
+        linkDeques.push_back(std::make_unique<WorkStealingDeque<LinkBatch *>>());
 
+        if (!existing)
                 threadFiles[i] << "[\n";
     }
 }
@@ -258,6 +467,16 @@ WebCrawler::WebCrawler(int threads, int depth, int delayMs)
 WebCrawler::~WebCrawler()
 {
     stop();
+    fetchEngines.clear();
+    curlShare.reset();
+    for (auto &deque : linkDeques)
+    {
+        LinkBatch *batch = nullptr;
+        while (deque->pop(batch))
+        {
+            delete batch;
+        }
+    }
     curl_global_cleanup();
     for (size_t i = 0; i < threadFiles.size(); ++i)
     {
@@ -273,32 +492,96 @@ WebCrawler::~WebCrawler()
    
 }
 
-void WebCrawler::start(const std::string &seedUrl)
+void WebCrawler::start(const std::string &seed)
 {
-    // Implementation
+    // A seed typed as a bare host, such as "example.com", is fetched over http
+    std::string seedUrl = normalizeUrl(seed.find("://") == std::string::npos ? "http://" + seed : seed);
+    if (seedUrl.empty())
+        throw std::runtime_error("Seed " + seed + " is not an http or https URL");
+    if (queryRules)
+        queryRules->apply(seedUrl);
+    startTime = std::chrono::steady_clock::now();
+    if (maxDepth <= 0)
+    {
+        // Nothing to crawl; completion is immediate
+        shouldStop = true;
+        return;
+    }
+
+    bool resumed = resume && resumeFromCheckpoint();
+    if (checkpointInterval.count() > 0)
+    {
+        if (!resumed)
+        {
+            // State left by an earlier crawl must not be replayed into this one
+            fs::remove(checkpointPath);
+            for (const auto &segment : WriteAheadLog::segments(stateDir))
+                fs::remove(segment);
+            removeSnapshotSegments("checkpoint_", false);
+        }
+        // Changes the log can no longer record would be lost in a crash, so stop
+        // the crawl; the last good snapshot and log stay in place for --resume
+        wal = std::make_unique<WriteAheadLog>(stateDir, walCommitInterval, [this](const std::string &) {
+            {
+                std::lock_guard<std::mutex> lock(doneMutex);
+                shouldStop = true;
+            }
+            doneCond.notify_all();
+            completedFetches.cancel();
+        });
+    }
+    if (!resumed)
     {
-        std::lock_guard<std::mutex> lock(visitedMutex);
         visitedUrls.insert(seedUrl);
+        pendingWork = 1;
+        urlQueue.push(make_pair(seedUrl, 0));
+        if (wal)
+            wal->append(WalRecord::Discovered, seedUrl, 0);
+    }
+    if (pendingWork == 0)
+    {
+        // The snapshot was taken after the crawl had already finished
+        shouldStop = true;
+        return;
+    }
+
+    for (auto &engine : fetchEngines)
+    {
+        engine->start();
     }
-    urlQueue.push(make_pair(seedUrl, 0));
 
     // Start worker threads
     for (int i = 0; i < numThreads; i++)
     {
         workers.emplace_back(&WebCrawler::workerThread, this, i);
     }
+
+    if (checkpointInterval.count() > 0)
+    {
+        checkpointThread = std::thread(&WebCrawler::checkpointLoop, this);
+    }
 }
 
 void WebCrawler::stop()
 {
-    // Implementation
-    shouldStop = true;
+    {
+        std::lock_guard<std::mutex> lock(doneMutex);
+        shouldStop = true;
+    }
+    doneCond.notify_all();
+    completedFetches.cancel();
     std::future<void> future = std::async(std::launch::async, [&]() {
+        if (checkpointThread.joinable()) {
+            checkpointThread.join();
+        }
         for (auto &worker : workers) {
             if (worker.joinable()) {
                 worker.join();
             }
         }
+        for (auto &engine : fetchEngines) {
+            engine->stop();
+        }
         system("node upload.js");
         workers.clear();
     });
@@ -310,13 +593,355 @@ void WebCrawler::stop()
 
 void WebCrawler::waitForCompletion()
 {
-    // Implementation
-    while (activeThreads > 0 || !urlQueue.empty())
     {
-        std::this_thread::sleep_for(100ms);
+        std::unique_lock<std::mutex> lock(doneMutex);
+        doneCond.wait(lock, [this] { return shouldStop.load(); });
     }
     stop();
-    
+    if (checkpointInterval.count() > 0)
+    {
+        // Record the finished state so a later --resume has nothing left to do
+        saveCheckpoint();
+    }
+    reportStats();
+}
+
+void WebCrawler::checkpointLoop()
+{
+    std::unique_lock<std::mutex> lock(doneMutex);
+    while (!doneCond.wait_for(lock, checkpointInterval, [this] { return shouldStop.load(); }))
+    {
+        lock.unlock();
+        saveCheckpoint();
+        lock.lock();
+    }
+}
+
+void WebCrawler::saveCheckpoint()
+{
+    auto begin = std::chrono::steady_clock::now();
+    uint64_t walStart = 0;
+    std::string linkPrefix;
+    std::vector<SpillRange> spilled;
+    try
+    {
+        // Changes from here on go to a new segment, which replay applies on top
+        // of this snapshot. Throws if the log has failed.
+        walStart = wal ? wal->rotate() : 0;
+        linkPrefix = "checkpoint_" + std::to_string(walStart) + "_";
+        CheckpointWriter writer(checkpointPath, static_cast<uint32_t>(visitedUrls.visitedMode()));
+        // Visited first: anything it holds is still pending or already done when
+        // the pending URLs are captured below
+        visitedUrls.save(writer);
+        writer.endSection();
+
+        std::vector<UrlFrontier::Item> pending;
+        std::vector<std::pair<uint64_t, std::chrono::system_clock::time_point>> hosts;
+        {
+            // Claims opened before this point may have put links in the saved set;
+            // wait for them to publish. Later claims only add links it does not hold.
+            std::unique_lock<std::mutex> lock(batchMutex);
+            int side = static_cast<int>(claimEpoch++ & 1);
+            claimsClosed.wait(lock, [this, side] { return openClaims[side] == 0; });
+            for (LinkBatch *batch : liveBatches)
+            {
+                pending.insert(pending.end(), batch->begin(), batch->end());
+            }
+            urlQueue.snapshot(pending, hosts, stateDir + "/" + linkPrefix + "frontier", spilled);
+        }
+
+        for (const auto &item : pending)
+        {
+            appendBytes(writer.out(), item.first);
+            appendU32(writer.out(), static_cast<uint32_t>(item.second));
+            writer.endRecord();
+        }
+        writer.endSection();
+        for (const auto &host : hosts)
+        {
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(host.second.time_since_epoch());
+            appendU64(writer.out(), host.first);
+            appendU64(writer.out(), static_cast<uint64_t>(ms.count()));
+            writer.endRecord();
+        }
+        writer.endSection();
+        for (const auto &range : spilled)
+        {
+            appendBytes(writer.out(), fs::path(range.path).filename().string());
+            appendU64(writer.out(), range.begin);
+            appendU64(writer.out(), range.end);
+            writer.endRecord();
+        }
+        writer.commit();
+
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+        std::cout << "Checkpoint: " << writer.count(CheckpointFile::Visited) << " visited, "
+                  << writer.count(CheckpointFile::Pending) << " pending, " << spilled.size() << " spilled segments, "
+                  << writer.count(CheckpointFile::Hosts) << " hosts in " << seconds << "s" << std::endl;
+    }
+    catch (const std::exception &e)
+    {
+        std::cerr << "Checkpoint failed: " << e.what() << std::endl;
+        if (!linkPrefix.empty())
+            removeSnapshotSegments(linkPrefix, false);
+        return;
+    }
+    // The segments the previous snapshot linked are not needed once this one is in place
+    removeSnapshotSegments(linkPrefix, true);
+    if (wal)
+        wal->removeBefore(walStart);
+}
+
+void WebCrawler::removeSnapshotSegments(const std::string &prefix, bool keep)
+{
+    for (const auto &entry : fs::directory_iterator(stateDir))
+    {
+        std::string name = entry.path().filename().string();
+        if (name.rfind("checkpoint_", 0) != 0 || entry.path().extension() != ".seg")
+            continue;
+        if ((name.rfind(prefix, 0) == 0) != keep)
+            fs::remove(entry.path());
+    }
+}
+
+bool WebCrawler::resumeFromCheckpoint()
+{
+    bool haveCheckpoint = fs::exists(checkpointPath);
+    std::vector<std::string> logs = WriteAheadLog::segments(stateDir);
+    if (!haveCheckpoint && logs.empty())
+    {
+        std::cout << "No checkpoint in " << stateDir << ", starting from the seed" << std::endl;
+        return false;
+    }
+
+    // A damaged snapshot is fatal: partially loaded state cannot be unwound
+    auto begin = std::chrono::steady_clock::now();
+    std::unordered_map<std::string, int> pending;
+    uint64_t visitedCount = 0;
+    uint64_t hostCount = 0;
+    if (haveCheckpoint)
+    {
+        CheckpointFile file(checkpointPath);
+        if (file.visitedMode() != static_cast<uint32_t>(visitedUrls.visitedMode()))
+        {
+            throw std::runtime_error("Checkpoint was written with a different --visited mode");
+        }
+        visitedCount = file.count(CheckpointFile::Visited);
+        if (!visitedUrls.load(file.cursor(CheckpointFile::Visited), visitedCount))
+        {
+            throw std::runtime_error("Checkpoint visited section is malformed");
+        }
+
+        // Deadlines go in before the URLs so refilled hosts keep their delay
+        CheckpointCursor hosts = file.cursor(CheckpointFile::Hosts);
+        uint64_t host;
+        uint64_t deadlineMs;
+        hostCount = file.count(CheckpointFile::Hosts);
+        for (uint64_t i = 0; i < hostCount; ++i)
+        {
+            if (!hosts.getU64(host) || !hosts.getU64(deadlineMs))
+                throw std::runtime_error("Checkpoint host section is malformed");
+            urlQueue.restoreHost(host, std::chrono::system_clock::time_point(std::chrono::milliseconds(deadlineMs)));
+        }
+
+        // A URL can be captured twice if it moved between sources mid-snapshot
+        CheckpointCursor cursor = file.cursor(CheckpointFile::Pending);
+        std::string url;
+        uint32_t depth;
+        for (uint64_t i = 0; i < file.count(CheckpointFile::Pending); ++i)
+        {
+            if (!cursor.getBytes(url) || !cursor.getU32(depth))
+                throw std::runtime_error("Checkpoint pending section is malformed");
+            pending.emplace(url, static_cast<int>(depth));
+        }
+
+        // The rest were on disk in the frontier, and the snapshot linked their segments
+        CheckpointCursor segments = file.cursor(CheckpointFile::Spilled);
+        std::vector<UrlFrontier::Item> spilled;
+        for (uint64_t i = 0; i < file.count(CheckpointFile::Spilled); ++i)
+        {
+            SpillRange range;
+            if (!segments.getBytes(range.path) || !segments.getU64(range.begin) || !segments.getU64(range.end))
+                throw std::runtime_error("Checkpoint spilled section is malformed");
+            range.path = stateDir + "/" + range.path;
+            if (!SpillQueue::load(range, spilled))
+                throw std::runtime_error("Checkpoint segment " + range.path + " is missing or truncated");
+            for (auto &item : spilled)
+                pending.emplace(std::move(item.first), item.second);
+            spilled.clear();
+        }
+    }
+
+    // Then everything logged since that snapshot, oldest segment first
+    size_t replayed = 0;
+    for (const auto &segment : logs)
+    {
+        replayed += WriteAheadLog::replay(segment, [&](WalRecord type, const std::string &url, int depth) {
+            if (type == WalRecord::Discovered)
+            {
+                visitedUrls.insert(url);
+                pending.emplace(url, depth);
+            }
+            else if (type == WalRecord::Done)
+            {
+                pending.erase(url);
+            }
+        });
+    }
+
+    LinkBatch items;
+    items.reserve(pending.size());
+    for (auto &entry : pending)
+    {
+        if (entry.second < maxDepth)
+            items.emplace_back(entry.first, entry.second);
+    }
+    pendingWork = static_cast<long>(items.size());
+    size_t restored = items.size();
+    urlQueue.push_batch(items);
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - begin).count();
+    std::cout << "Resumed from " << stateDir << ": " << visitedCount << " visited, " << hostCount << " hosts from the checkpoint, "
+              << replayed << " log records from " << logs.size() << " segments, " << restored << " pending in "
+              << seconds << "s" << std::endl;
+    return true;
+}
+
+void WebCrawler::reportStats()
+{
+    FetchStats total;
+    for (auto &engine : fetchEngines)
+    {
+        FetchStats s = engine->stats();
+        total.completed += s.completed;
+        total.handlesCreated += s.handlesCreated;
+        total.connectionsOpened += s.connectionsOpened;
+        total.connectionsReused += s.connectionsReused;
+        total.scannedBytes += s.scannedBytes;
+        total.scanNanos += s.scanNanos;
+        total.stoppedEarly += s.stoppedEarly;
+        total.skippedNonHtml += s.skippedNonHtml;
+        total.bytesSaved += s.bytesSaved;
+        total.savedPages += s.savedPages;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - startTime).count();
+    std::cout << "Fetched " << total.completed << " pages in " << seconds << "s ("
+              << (seconds > 0 ? total.completed / seconds : 0) << " requests/s)" << std::endl;
+    std::cout << "Easy handles created: " << total.handlesCreated
+              << ", connections opened: " << total.connectionsOpened
+              << ", connections reused (per fetch engine pool): " << total.connectionsReused << std::endl;
+
+    ShareStats shared = curlShare->stats();
+    std::cout << "Shared DNS cache hits/misses: " << shared.dnsHits << "/" << shared.dnsMisses << " ("
+              << (shared.dnsMisses ? shared.dnsMicros / shared.dnsMisses : 0) << " us per lookup), TLS handshakes: "
+              << shared.tlsHandshakes << " (" << (shared.tlsHandshakes ? shared.tlsMicros / shared.tlsHandshakes : 0)
+              << " us each)" << std::endl;
+
+    SpillStats spill = urlQueue.spillStats();
+    if (spill.spilledItems > 0)
+    {
+        std::cout << "Frontier spilled " << spill.spilledItems << " URLs ("
+                  << (spill.spillSeconds > 0 ? spill.spilledBytes / spill.spillSeconds / 1e6 : 0) << " MB/s), refilled "
+                  << spill.refilledItems << " URLs ("
+                  << (spill.refillSeconds > 0 ? spill.refilledBytes / spill.refillSeconds / 1e6 : 0) << " MB/s)" << std::endl;
+    }
+
+    if (wal)
+    {
+        WalStats log = wal->stats();
+        std::cout << "Write-ahead log: " << log.records << " records, " << log.bytes << " bytes in " << log.commits
+                  << " group commits (" << (log.commits ? static_cast<double>(log.records) / log.commits : 0)
+                  << " records/commit)" << std::endl;
+    }
+
+    if (queryRules)
+    {
+        for (const auto &rule : queryRules->stats())
+        {
+            if (rule.rewritten > 0)
+                std::cout << "Query rule '" << rule.rule << "': " << rule.rewritten << " URLs rewritten, "
+                          << rule.collapsed << " collapsed into already-seen URLs" << std::endl;
+        }
+    }
+
+    if (domBytes > 0)
+    {
+        std::cout << "Gumbo extraction: " << domBytes << " bytes at " << domBytes * 1e3 / std::max<size_t>(1, domNanos)
+                  << " MB/s" << (parseArena ? " (arena)" : " (malloc)") << std::endl;
+    }
+    ArenaStats arena = ParseArena::stats();
+    if (arena.pages > 0)
+    {
+        std::cout << "Parse arena: " << arena.allocations / arena.pages << " allocations and "
+                  << arena.bytes / arena.pages << " bytes per page, largest page " << arena.largestPage << " bytes"
+                  << std::endl;
+    }
+    if (scanBytes > 0)
+    {
+        std::cout << "Link scanner (" << linkScannerIsa() << "): " << scanBytes << " bytes at "
+                  << scanBytes * 1e3 / std::max<size_t>(1, scanNanos) << " MB/s" << std::endl;
+    }
+    if (total.scannedBytes > 0)
+    {
+        std::cout << "Link scanner (" << linkScannerIsa() << ", while receiving): " << total.scannedBytes
+                  << " bytes at " << total.scannedBytes * 1e3 / std::max<size_t>(1, total.scanNanos) << " MB/s, "
+                  << (total.completed ? total.scanNanos / 1e3 / total.completed : 0) << " us per page on the fetch threads"
+                  << std::endl;
+    }
+    if (total.stoppedEarly > 0)
+    {
+        std::cout << "Head-only: " << total.stoppedEarly << " downloads stopped early (" << total.skippedNonHtml
+                  << " not HTML), " << total.bytesSaved << " bytes saved";
+        if (total.savedPages > 0)
+            std::cout << ", " << total.bytesSaved / total.savedPages << " per page where the length was known";
+        std::cout << std::endl;
+    }
+    if (extractMode == ExtractMode::Compare)
+    {
+        std::cout << "Link scanner matched Gumbo on " << comparedPages - mismatchedPages << " of " << comparedPages
+                  << " pages" << std::endl;
+    }
+
+    if (redirectHops + redirectDuplicates > 0)
+    {
+        std::cout << "Redirects: " << redirectHops << " hops marked visited, " << redirectDuplicates
+                  << " pages not expanded because their final URL was already claimed" << std::endl;
+    }
+
+    if (noindexPages + nofollowPages + nofollowLinks + canonicalPages > 0)
+    {
+        std::cout << "Robots and canonical hints: " << noindexPages << " noindex pages, " << nofollowPages
+                  << " nofollow pages, " << nofollowLinks << " rel=nofollow links, " << canonicalPages
+                  << " pages deferring to a canonical URL" << std::endl;
+    }
+
+    if (traps)
+    {
+        TrapStats trapped = traps->stats();
+        size_t rejected = trapped.tooLong + trapped.repeatedSegments + trapped.patternFanout + trapped.quarantined;
+        if (rejected > 0)
+            std::cout << "Trap detector rejected " << rejected << " URLs (" << trapped.tooLong << " too long, "
+                      << trapped.repeatedSegments << " repeated segments, " << trapped.patternFanout
+                      << " pattern fan-out, " << trapped.quarantined << " on quarantined patterns); "
+                      << trapped.trappedPatterns << " patterns capped, " << trapped.quarantinedPatterns
+                      << " patterns quarantined" << std::endl;
+    }
+
+    VisitedStats visited = visitedUrls.stats();
+    std::cout << "Visited set: " << visited.urls << " URLs, " << visited.memoryBytes << " bytes ("
+              << (visited.urls ? static_cast<double>(visited.memoryBytes) / visited.urls : 0) << " bytes/URL)";
+    if (visited.expectedCollisions > 0)
+    {
+        std::cout << ", expected false collisions " << visited.expectedCollisions
+                  << " (rate " << visited.expectedCollisions / visited.urls << " per URL)";
+    }
+    if (visited.diskBytes > 0)
+    {
+        std::cout << ", " << visited.diskBytes << " bytes on disk, Bloom positives " << visited.bloomPositives
+                  << " of which false " << visited.bloomFalsePositives;
+    }
+    std::cout << std::endl;
 }
 
 
@@ -0,0 +1,278 @@
+#include "write_ahead_log.h"
+#include "fingerprint.h"
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace fs = std::filesystem;
+
+// Record layout: [u32 checksum][u8 type][i32 depth][u32 length][url bytes].
+// The checksum covers everything after it, so a torn tail is detected.
+static const size_t kRecordHeader = 4 + 1 + 4 + 4;
+
+static std::string segmentName(uint64_t seq)
+{
+    char name[32];
+    snprintf(name, sizeof(name), "wal_%012llu.log", static_cast<unsigned long long>(seq));
+    return name;
+}
+
+static bool parseSegment(const std::string &name, uint64_t &seq)
+{
+    if (name.size() != 20 || name.compare(0, 4, "wal_") != 0 || name.compare(16, 4, ".log") != 0)
+        return false;
+    seq = std::strtoull(name.c_str() + 4, nullptr, 10);
+    return true;
+}
+
+static uint32_t checksum(const char *data, size_t length)
+{
+    return static_cast<uint32_t>(fingerprint128(data, length).lo);
+}
+
+WriteAheadLog::WriteAheadLog(const std::string &dir, std::chrono::milliseconds interval,
+                             std::function<void(const std::string &)> failed)
+    : directory(dir), commitInterval(interval), fd(-1), sequence(0), onFailure(std::move(failed))
+{
+    fs::create_directories(directory);
+    std::vector<std::string> existing = segments(directory);
+    if (!existing.empty())
+    {
+        parseSegment(fs::path(existing.back()).filename().string(), sequence);
+        sequence++;
+    }
+    openSegment(sequence);
+    flusher = std::thread(&WriteAheadLog::run, this);
+}
+
+WriteAheadLog::~WriteAheadLog()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    flushCond.notify_all();
+    flusher.join();
+    std::unique_lock<std::mutex> lock(mutex);
+    flush(lock);
+    close(fd);
+}
+
+void WriteAheadLog::openSegment(uint64_t seq)
+{
+    std::string path = directory + "/" + segmentName(seq);
+    fd = open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644);
+    if (fd < 0)
+    {
+        throw std::runtime_error("Cannot open write-ahead log " + path);
+    }
+}
+
+void WriteAheadLog::encode(WalRecord type, const std::string &url, int depth)
+{
+    size_t start = buffer.size();
+    buffer.resize(start + kRecordHeader + url.size());
+    char *record = &buffer[start];
+    uint8_t kind = static_cast<uint8_t>(type);
+    int32_t level = depth;
+    uint32_t length = static_cast<uint32_t>(url.size());
+    std::memcpy(record + 4, &kind, 1);
+    std::memcpy(record + 5, &level, 4);
+    std::memcpy(record + 9, &length, 4);
+    std::memcpy(record + kRecordHeader, url.data(), url.size());
+    uint32_t sum = checksum(record + 4, kRecordHeader - 4 + url.size());
+    std::memcpy(record, &sum, 4);
+}
+
+void WriteAheadLog::append(WalRecord type, const std::string &url, int depth)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (broken)
+        return;
+    encode(type, url, depth);
+    records++;
+}
+
+void WriteAheadLog::appendBatch(WalRecord type, const std::vector<std::pair<std::string, int>> &items)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    if (broken)
+        return;
+    for (const auto &item : items)
+    {
+        encode(type, item.first, item.second);
+    }
+    records += items.size();
+}
+
+// Called with mutex held; returns with it held
+void WriteAheadLog::flush(std::unique_lock<std::mutex> &lock)
+{
+    if (buffer.empty())
+        return;
+    std::string pending;
+    pending.swap(buffer);
+    std::string error;
+    {
+        std::lock_guard<std::mutex> fileLock(fileMutex);
+        lock.unlock();
+        if (broken)
+        {
+            // Appends racing the failure; nothing may follow a torn record
+            lock.lock();
+            return;
+        }
+
+        const char *data = pending.data();
+        size_t left = pending.size();
+        while (left > 0)
+        {
+            ssize_t written = write(fd, data, left);
+            if (written < 0 && errno == EINTR)
+                continue;
+            if (written <= 0)
+            {
+                error = std::string("write failed: ") + std::strerror(errno);
+                break;
+            }
+            data += written;
+            left -= static_cast<size_t>(written);
+        }
+        if (error.empty() && fdatasync(fd) != 0)
+            error = std::string("fdatasync failed: ") + std::strerror(errno);
+        if (error.empty())
+        {
+            commits++;
+            bytes += pending.size();
+        }
+        else
+        {
+            error = "Write-ahead log segment " + std::to_string(sequence) + " " + error;
+            broken = true;
+        }
+    }
+    if (!error.empty())
+    {
+        std::cerr << error << std::endl;
+        if (onFailure)
+            onFailure(error);
+    }
+    lock.lock();
+    if (broken)
+        buffer.clear();
+}
+
+void WriteAheadLog::run()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    while (!stopping)
+    {
+        flushCond.wait_for(lock, commitInterval, [this] { return stopping; });
+        flush(lock);
+    }
+}
+
+uint64_t WriteAheadLog::rotate()
+{
+    std::unique_lock<std::mutex> lock(mutex);
+    flush(lock);
+    if (broken)
+        throw std::runtime_error("Write-ahead log failed, records since segment " + std::to_string(sequence) +
+                                 " may be lost");
+    // Hold the file across the switch so no flush lands between segments
+    std::lock_guard<std::mutex> fileLock(fileMutex);
+    close(fd);
+    openSegment(++sequence);
+    return sequence;
+}
+
+void WriteAheadLog::removeBefore(uint64_t seq)
+{
+    for (const auto &path : segments(directory))
+    {
+        uint64_t current;
+        if (parseSegment(fs::path(path).filename().string(), current) && current < seq)
+            fs::remove(path);
+    }
+}
+
+WalStats WriteAheadLog::stats() const
+{
+    WalStats s;
+    s.records = records;
+    s.commits = commits;
+    s.bytes = bytes;
+    return s;
+}
+
+std::vector<std::string> WriteAheadLog::segments(const std::string &dir)
+{
+    std::vector<std::pair<uint64_t, std::string>> found;
+    if (fs::is_directory(dir))
+    {
+        for (const auto &entry : fs::directory_iterator(dir))
+        {
+            uint64_t seq;
+            if (parseSegment(entry.path().filename().string(), seq))
+                found.emplace_back(seq, entry.path().string());
+        }
+    }
+    std::sort(found.begin(), found.end());
+
+    std::vector<std::string> paths;
+    for (auto &segment : found)
+    {
+        paths.push_back(std::move(segment.second));
+    }
+    return paths;
+}
+
+size_t WriteAheadLog::replay(const std::string &path, const std::function<void(WalRecord, const std::string &, int)> &apply)
+{
+    int file = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (file < 0)
+        return 0;
+    struct stat st;
+    if (fstat(file, &st) != 0 || st.st_size == 0)
+    {
+        close(file);
+        return 0;
+    }
+    size_t length = static_cast<size_t>(st.st_size);
+    void *addr = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, file, 0);
+    close(file);
+    if (addr == MAP_FAILED)
+        return 0;
+
+    const char *data = static_cast<const char *>(addr);
+    size_t offset = 0;
+    size_t applied = 0;
+    std::string url;
+    while (length - offset >= kRecordHeader)
+    {
+        const char *record = data + offset;
+        uint32_t sum;
+        uint8_t kind;
+        int32_t depth;
+        uint32_t size;
+        std::memcpy(&sum, record, 4);
+        std::memcpy(&kind, record + 4, 1);
+        std::memcpy(&depth, record + 5, 4);
+        std::memcpy(&size, record + 9, 4);
+        if (size > length - offset - kRecordHeader || checksum(record + 4, kRecordHeader - 4 + size) != sum)
+            break; // Torn write at the tail
+        url.assign(record + kRecordHeader, size);
+        apply(static_cast<WalRecord>(kind), url, depth);
+        offset += kRecordHeader + size;
+        applied++;
+    }
+    munmap(addr, length);
+    return applied;
+}